@@ -0,0 +1,288 @@
+/*
+ *     TTY-CLOCK alarm.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alarm.h"
+
+/* Min-heap of the alarms, keyed on the epoch they go off */
+static struct {
+    alarm_t *heap;
+    size_t count;
+    size_t size;
+} alarms;
+
+
+/* Prototypes */
+static bool parse(char *line, time_t now, alarm_t *alarm);
+static time_t next_day(time_t when);
+static bool push(const alarm_t *alarm);
+static void sift_up(size_t i);
+static void sift_down(size_t i);
+
+
+/**
+ * Parse '[YYYY-MM-DD] HH:MM[:SS] duration flash|color N'. Alarms without a
+ * date go off every day.
+ */
+static bool
+parse(char *line, time_t now, alarm_t *alarm)
+{
+    char *tok[5], *save = NULL;
+    int n, i = 0;
+    struct tm tm;
+
+    for(n = 0; n < 5 && (tok[n] = strtok_r((n) ? NULL : line, " \t\r\n", &save)); ++n);
+
+    if(!n || *tok[0] == '#') {
+        return false;
+    }
+
+    memset(alarm, 0, sizeof(alarm_t));
+    localtime_r(&now, &tm);
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+
+    if(strchr(tok[0], '-')) {
+        if(sscanf(tok[i++], "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) != 3) {
+            return false;
+        }
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+    } else {
+        alarm->daily = true;
+    }
+
+    /* time, duration and effect */
+    if(n - i < 3 || sscanf(tok[i], "%d:%d:%d", &tm.tm_hour, &tm.tm_min, &tm.tm_sec) < 2) {
+        return false;
+    }
+
+    alarm->duration = atol(tok[i + 1]);
+    if(!strcmp(tok[i + 2], "flash")) {
+        alarm->effect = ALARM_FLASH;
+    } else if(!strcmp(tok[i + 2], "color") && n - i > 3) {
+        alarm->effect = ALARM_COLOR;
+        alarm->color = (short)atoi(tok[i + 3]);
+    } else {
+        return false;
+    }
+    if(alarm->duration < 1 || alarm->color < 0 || alarm->color > 7) {
+        return false;
+    }
+
+    alarm->when = mktime(&tm);
+    if(alarm->daily && alarm->when <= now) {
+        alarm->when = next_day(alarm->when);
+    }
+
+    return (alarm->when > now);
+}
+
+
+/**
+ * Same local time on the next day, DST changes included. This runs whenever
+ * a daily alarm fires, and mktime() would call tzset(), which allocates on
+ * every call in glibc unless TZ is set, so only localtime_r() is used.
+ */
+static time_t
+next_day(time_t when)
+{
+    const time_t next = when + 24 * 3600;
+    struct tm was, tm;
+    time_t shifted;
+    long shift;
+
+    localtime_r(&when, &was);
+    localtime_r(&next, &tm);
+
+    /* The UTC offset changed in between, by less than half a day */
+    shift = (was.tm_hour - tm.tm_hour) * 3600L + (was.tm_min - tm.tm_min) * 60L
+            + (was.tm_sec - tm.tm_sec);
+    if(shift > 12 * 3600L) {
+        shift -= 24 * 3600L;
+    } else if(shift < -12 * 3600L) {
+        shift += 24 * 3600L;
+    }
+    if(!shift) {
+        return next;
+    }
+
+    /* A time the clocks skip is taken as the hour after, as mktime() does */
+    shifted = next + shift;
+    localtime_r(&shifted, &tm);
+
+    return (tm.tm_hour == was.tm_hour && tm.tm_min == was.tm_min) ? shifted : next;
+}
+
+
+static bool
+push(const alarm_t *alarm)
+{
+    alarm_t *heap;
+
+    if(alarms.count == alarms.size) {
+        heap = realloc(alarms.heap, (alarms.size + ALARM_CHUNK) * sizeof(alarm_t));
+        if(!heap) {
+            return false;
+        }
+        alarms.heap = heap;
+        alarms.size += ALARM_CHUNK;
+    }
+
+    alarms.heap[alarms.count] = *alarm;
+    sift_up(alarms.count++);
+
+    return true;
+}
+
+
+static void
+sift_up(size_t i)
+{
+    alarm_t tmp;
+
+    while(i && alarms.heap[(i - 1) / 2].when > alarms.heap[i].when) {
+        tmp = alarms.heap[i];
+        alarms.heap[i] = alarms.heap[(i - 1) / 2];
+        alarms.heap[(i - 1) / 2] = tmp;
+        i = (i - 1) / 2;
+    }
+
+    return;
+}
+
+
+static void
+sift_down(size_t i)
+{
+    size_t min, c;
+    alarm_t tmp;
+
+    for(;;) {
+        min = i;
+        for(c = 2 * i + 1; c <= 2 * i + 2 && c < alarms.count; ++c) {
+            if(alarms.heap[c].when < alarms.heap[min].when) {
+                min = c;
+            }
+        }
+        if(min == i) {
+            break;
+        }
+        tmp = alarms.heap[i];
+        alarms.heap[i] = alarms.heap[min];
+        alarms.heap[min] = tmp;
+        i = min;
+    }
+
+    return;
+}
+
+
+/**
+ * Load the alarms of a file, the ones which are already over are skipped
+ */
+bool
+alarm_load(const char *path, time_t now)
+{
+    char line[ALARM_LINE_SIZE];
+    alarm_t alarm;
+    FILE *file;
+
+    if(!(file = fopen(path, "r"))) {
+        return false;
+    }
+
+    while(fgets(line, sizeof(line), file)) {
+        if(parse(line, now, &alarm) && !push(&alarm)) {
+            fclose(file);
+
+            return false;
+        }
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+
+/**
+ * Epoch of the next alarm, 0 if there is none. O(1).
+ */
+time_t
+alarm_next(void)
+{
+    return (alarms.count) ? alarms.heap[0].when : 0;
+}
+
+
+/**
+ * Take all the alarms due at now off the heap, daily ones are queued again
+ * for the next day. The latest of them is returned in fired.
+ */
+bool
+alarm_fire(time_t now, alarm_t *fired)
+{
+    bool ret = false;
+
+    while(alarms.count && alarms.heap[0].when <= now) {
+        *fired = alarms.heap[0];
+        ret = true;
+
+        if(fired->daily) {
+            while(alarms.heap[0].when <= now) {
+                alarms.heap[0].when = next_day(alarms.heap[0].when);
+            }
+        } else {
+            alarms.heap[0] = alarms.heap[--alarms.count];
+        }
+        sift_down(0);
+    }
+
+    return ret;
+}
+
+
+void
+alarm_free(void)
+{
+    free(alarms.heap);
+    memset(&alarms, 0, sizeof(alarms));
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
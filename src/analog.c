@@ -0,0 +1,348 @@
+/*
+ *     TTY-CLOCK analog.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "analog.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Braille dot bits, indexed [row][column] of the 2x4 dot cell */
+static const unsigned char braille_bit[4][2] = {
+    {0x01, 0x08},
+    {0x02, 0x10},
+    {0x04, 0x20},
+    {0x40, 0x80},
+};
+
+/* Sin/cos of the 60 hand positions, clockwise from 12 o'clock */
+static double hand_sin[ANALOG_POSITIONS];
+static double hand_cos[ANALOG_POSITIONS];
+static bool table_ready;
+
+/* Analog dial state */
+static struct {
+    int w, h;            /* size in cells */
+    int cx, cy, r;       /* centre and radius in dots */
+    unsigned char *dial; /* cached static face, one braille mask per cell */
+    unsigned char *hand; /* hand overlay, one braille mask per cell */
+    int *touched;        /* cells under the hands (old ones first, then new) */
+    int ntouched;
+    int maxtouched;
+    bool overflow;       /* a hand cell didn't fit in touched, clear them all */
+    int pos[3];          /* hour, minute and second position last drawn */
+    bool valid;          /* false if the whole face has to be repainted */
+} analog;
+
+
+/* Prototypes */
+static void init_table(void);
+static void plot(unsigned char *buf, int x, int y, bool track);
+static void draw_line(unsigned char *buf, int x0, int y0, int x1, int y1, bool track);
+static void draw_radial(unsigned char *buf, int pos, int from, int to, bool track);
+static void draw_cell(WINDOW *win, int x, int y, int cell);
+
+
+/**
+ * Precompute the sin/cos tables for the hand positions
+ */
+static void
+init_table(void)
+{
+    int i;
+
+    for(i = 0; i < ANALOG_POSITIONS; ++i) {
+        hand_sin[i] = sin(2.0 * M_PI * i / ANALOG_POSITIONS);
+        hand_cos[i] = cos(2.0 * M_PI * i / ANALOG_POSITIONS);
+    }
+    table_ready = true;
+
+    return;
+}
+
+
+/**
+ * Set the dot (x, y) in the given cell buffer and optionally remember its cell
+ */
+static void
+plot(unsigned char *buf, int x, int y, bool track)
+{
+    int cell;
+
+    if(x < 0 || y < 0 || x >= analog.w * 2 || y >= analog.h * 4) {
+        return;
+    }
+
+    cell = (y / 4) * analog.w + (x / 2);
+
+    /* The overlay only holds the new hands, an empty cell isn't listed yet */
+    if(track && !buf[cell]) {
+        if(analog.ntouched < analog.maxtouched) {
+            analog.touched[analog.ntouched++] = cell;
+        } else {
+            analog.overflow = true;
+        }
+    }
+    buf[cell] |= braille_bit[y % 4][x % 2];
+
+    return;
+}
+
+
+/**
+ * Bresenham line in dot coordinates
+ */
+static void
+draw_line(unsigned char *buf, int x0, int y0, int x1, int y1, bool track)
+{
+    int dx = abs(x1 - x0), sx = (x0 < x1) ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = (y0 < y1) ? 1 : -1;
+    int err = dx + dy, e2;
+
+    for(;;) {
+        plot(buf, x0, y0, track);
+        if(x0 == x1 && y0 == y1) {
+            break;
+        }
+        e2 = 2 * err;
+        if(e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if(e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * Line along a hand position between two radii (in 1/100 of the dial radius)
+ */
+static void
+draw_radial(unsigned char *buf, int pos, int from, int to, bool track)
+{
+    double r0 = analog.r * from / 100.0;
+    double r1 = analog.r * to / 100.0;
+
+    draw_line(buf,
+              analog.cx + (int)lround(r0 * hand_sin[pos]),
+              analog.cy - (int)lround(r0 * hand_cos[pos]),
+              analog.cx + (int)lround(r1 * hand_sin[pos]),
+              analog.cy - (int)lround(r1 * hand_cos[pos]),
+              track);
+
+    return;
+}
+
+
+/**
+ * Put one braille cell (dial and hands merged) into the window
+ */
+static void
+draw_cell(WINDOW *win, int x, int y, int cell)
+{
+    const unsigned char mask = analog.dial[cell] | analog.hand[cell];
+    char str[4] = " ";
+
+    /* U+2800 + mask as UTF-8 */
+    if(mask) {
+        str[0] = (char)0xE2;
+        str[1] = (char)(0xA0 | (mask >> 6));
+        str[2] = (char)(0x80 | (mask & 0x3F));
+    }
+
+    mvwaddstr(win, y + cell / analog.w, x + cell % analog.w, str);
+
+    return;
+}
+
+
+/**
+ * Rebuild the cached dial for an area of w x h cells
+ */
+bool
+analog_resize(int w, int h)
+{
+    const int r = ((w < 2 * h) ? w : 2 * h) - 1;
+    int i, steps;
+
+    if(w < 1 || h < 1) {
+        return false;
+    }
+
+    if(!table_ready) {
+        init_table();
+    }
+
+    if(w != analog.w || h != analog.h) {
+        analog_free();
+
+        analog.dial = calloc((size_t)(w * h), 1);
+        analog.hand = calloc((size_t)(w * h), 1);
+        /* A hand has at most one cell per dot, for the old and the new frame */
+        analog.maxtouched = 2 * ((r * ANALOG_HOURLEN / 100 + 2)
+                                 + (r * ANALOG_MINLEN / 100 + 2)
+                                 + (r * ANALOG_SECLEN / 100 + 2));
+        analog.touched = calloc((size_t)analog.maxtouched, sizeof(int));
+        if(!analog.dial || !analog.hand || !analog.touched) {
+            analog_free();
+
+            return false;
+        }
+        analog.w = w;
+        analog.h = h;
+    } else {
+        memset(analog.dial, 0, (size_t)(w * h));
+        memset(analog.hand, 0, (size_t)(w * h));
+    }
+
+    /* A braille dot is roughly square, so the dial is a circle in dots */
+    analog.cx = w;
+    analog.cy = 2 * h;
+    analog.r = r;
+
+    /* Rim */
+    steps = 8 * analog.r + 8;
+    for(i = 0; i < steps; ++i) {
+        plot(analog.dial,
+             analog.cx + (int)lround(analog.r * sin(2.0 * M_PI * i / steps)),
+             analog.cy - (int)lround(analog.r * cos(2.0 * M_PI * i / steps)),
+             false);
+    }
+
+    /* Hour marks */
+    for(i = 0; i < ANALOG_POSITIONS; i += 5) {
+        draw_radial(analog.dial, i, 100 - ANALOG_TICKLEN, 100, false);
+    }
+
+    analog_invalidate();
+
+    return true;
+}
+
+
+/**
+ * Force a full repaint of the face with the next analog_draw()
+ */
+void
+analog_invalidate(void)
+{
+    analog.valid = false;
+
+    return;
+}
+
+
+/**
+ * Draw the dial at (x, y) of the window, touching only the cells under the old
+ * and new hands unless the face has been invalidated
+ */
+void
+analog_draw(WINDOW *win, int x, int y, const struct tm *tm, bool second)
+{
+    int pos[3], old, i;
+
+    if(!analog.dial) {
+        return;
+    }
+
+    pos[0] = (tm->tm_hour % 12) * 5 + tm->tm_min / 12;
+    pos[1] = tm->tm_min;
+    pos[2] = (second) ? tm->tm_sec : -1;
+
+    if(analog.valid && !memcmp(pos, analog.pos, sizeof(pos))) {
+        return;
+    }
+
+    /* Lift the old hands off the overlay, all of it if some weren't listed */
+    if(analog.overflow) {
+        memset(analog.hand, 0, (size_t)(analog.w * analog.h));
+        analog.ntouched = 0;
+        analog.overflow = false;
+        analog.valid = false;
+    }
+    old = analog.ntouched;
+    for(i = 0; i < old; ++i) {
+        analog.hand[analog.touched[i]] = 0;
+    }
+
+    /* Rasterise the new hands, appending their cells behind the old ones */
+    draw_radial(analog.hand, pos[0], 0, ANALOG_HOURLEN, true);
+    draw_radial(analog.hand, pos[1], 0, ANALOG_MINLEN, true);
+    if(pos[2] >= 0) {
+        draw_radial(analog.hand, pos[2], 0, ANALOG_SECLEN, true);
+    }
+
+    if(analog.valid && !analog.overflow) {
+        for(i = 0; i < analog.ntouched; ++i) {
+            draw_cell(win, x, y, analog.touched[i]);
+        }
+    } else {
+        for(i = 0; i < analog.w * analog.h; ++i) {
+            draw_cell(win, x, y, i);
+        }
+    }
+
+    /* Keep only the new hands for the next frame */
+    analog.ntouched -= old;
+    memmove(analog.touched, analog.touched + old, (size_t)analog.ntouched * sizeof(int));
+    memcpy(analog.pos, pos, sizeof(pos));
+    analog.valid = true;
+
+    return;
+}
+
+
+/**
+ * Free the dial cache
+ */
+void
+analog_free(void)
+{
+    free(analog.dial);
+    free(analog.hand);
+    free(analog.touched);
+    memset(&analog, 0, sizeof(analog));
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,57 @@
+/*
+ *     TTY-CLOCK analog.h file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#ifndef ANALOG_H
+#define ANALOG_H
+
+#include <stdbool.h>
+#include <time.h>
+#include <ncurses.h>
+
+/* Hand lengths in 1/100 of the dial radius */
+#define ANALOG_HOURLEN   50
+#define ANALOG_MINLEN    80
+#define ANALOG_SECLEN    90
+#define ANALOG_TICKLEN   12
+#define ANALOG_POSITIONS 60
+
+bool analog_resize(int w, int h);
+void analog_invalidate(void);
+void analog_draw(WINDOW *win, int x, int y, const struct tm *tm, bool second);
+void analog_free(void);
+
+#endif /* ANALOG_H */
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,331 @@
+/*
+ *     TTY-CLOCK anim.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "anim.h"
+
+/*
+ * Every frame of a transition is built from the cached rows of the old and
+ * the new glyph, a pixel being one bit. An effect has a fixed number of
+ * distinct steps, frames are only drawn when the step changes and no more
+ * often than the budget allows. The cache is shared by all clocks.
+ */
+static uint8_t glyph[10][ANIM_ROWS];
+
+/* Order in which the pixels of the new glyph show up in a dissolve */
+static const uint8_t dissolve[ANIM_ROWS * ANIM_COLS] = {
+    7, 2, 12, 4, 9, 0, 14, 5, 10, 1, 13, 6, 3, 11, 8
+};
+
+/* Rows shown during a flip, negative for the old glyph */
+static const int flip[] = { -3, -1, 1, 3 };
+
+
+/* Prototypes */
+static int steps(int effect);
+static void squeeze(const uint8_t *src, int height, uint8_t *rows);
+static void frame(const anim_t *anim, int slot, int step, uint8_t *rows);
+
+
+/**
+ * Number of frames between the old and the new glyph
+ */
+static int
+steps(int effect)
+{
+    switch(effect) {
+    case ANIM_SLIDE:
+        return ANIM_ROWS - 1;
+    case ANIM_DISSOLVE:
+        return ANIM_ROWS * ANIM_COLS - 1;
+    case ANIM_FLIP:
+        return (int)(sizeof(flip) / sizeof(flip[0]));
+    default:
+        return 1;
+    }
+}
+
+
+/**
+ * Glyph shrunk to height rows around the middle one
+ */
+static void
+squeeze(const uint8_t *src, int height, uint8_t *rows)
+{
+    const int top = (ANIM_ROWS - height) / 2;
+    int r;
+
+    for(r = 0; r < ANIM_ROWS; ++r) {
+        if(r < top || r >= top + height) {
+            rows[r] = 0;
+        } else if(height == 1) {
+            rows[r] = src[ANIM_ROWS / 2];
+        } else {
+            rows[r] = src[(r - top) * (ANIM_ROWS - 1) / (height - 1)];
+        }
+    }
+
+    return;
+}
+
+
+static void
+frame(const anim_t *anim, int slot, int step, uint8_t *rows)
+{
+    const uint8_t *from = glyph[anim->slot[slot].from];
+    const uint8_t *to = glyph[anim->slot[slot].to];
+    const int shown = step + 1;
+    int r, i;
+
+    switch(anim->slot[slot].effect) {
+    case ANIM_SLIDE:
+        /* The new glyph comes down from the top, pushing the old one out */
+        for(r = 0; r < ANIM_ROWS; ++r) {
+            rows[r] = (r < shown) ? to[ANIM_ROWS - shown + r] : from[r - shown];
+        }
+        break;
+    case ANIM_DISSOLVE:
+        memcpy(rows, from, ANIM_ROWS);
+        for(i = 0; i < ANIM_ROWS * ANIM_COLS; ++i) {
+            if(dissolve[i] < shown) {
+                r = i / ANIM_COLS;
+                rows[r] &= (uint8_t)~(4 >> (i % ANIM_COLS));
+                rows[r] |= to[r] & (4 >> (i % ANIM_COLS));
+            }
+        }
+        break;
+    case ANIM_FLIP:
+        squeeze((flip[step] < 0) ? from : to,
+                (flip[step] < 0) ? -flip[step] : flip[step], rows);
+        break;
+    default:
+        memcpy(rows, to, ANIM_ROWS);
+        break;
+    }
+
+    return;
+}
+
+
+/**
+ * Effect for a name, -1 if unknown
+ */
+int
+anim_effect(const char *name)
+{
+    static const char *names[] = { "none", "slide", "dissolve", "flip" };
+    int i;
+
+    for(i = 0; i < (int)(sizeof(names) / sizeof(names[0])); ++i) {
+        if(!strcmp(name, names[i])) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * Cache the glyphs as rows of bits, the leftmost pixel being the highest
+ */
+void
+anim_init(const bool glyphs[][ANIM_ROWS * ANIM_COLS])
+{
+    int n, i;
+
+    memset(glyph, 0, sizeof(glyph));
+    for(n = 0; n < 10; ++n) {
+        for(i = 0; i < ANIM_ROWS * ANIM_COLS; ++i) {
+            if(glyphs[n][i]) {
+                glyph[n][i / ANIM_COLS] |= (uint8_t)(4 >> (i % ANIM_COLS));
+            }
+        }
+    }
+
+    return;
+}
+
+
+void
+anim_reset(anim_t *anim)
+{
+    memset(anim, 0, sizeof(*anim));
+    anim->interval = ANIM_FRAME;
+
+    return;
+}
+
+
+/**
+ * Cached rows of digit n
+ */
+void
+anim_rows(int n, uint8_t rows[ANIM_ROWS])
+{
+    memcpy(rows, glyph[n], ANIM_ROWS);
+
+    return;
+}
+
+
+/**
+ * Rows to draw for digit n in slot, starting a transition if the digit
+ * changed
+ */
+void
+anim_glyph(anim_t *anim, int slot, int n, int effect, uint64_t now, uint8_t rows[ANIM_ROWS])
+{
+    int step;
+
+    if(!anim->slot[slot].ready || effect == ANIM_NONE) {
+        anim->slot[slot].ready = true;
+        anim->slot[slot].to = n;
+        anim->slot[slot].active = false;
+    } else if(n != anim->slot[slot].to) {
+        /* A transition still running is cut short */
+        anim->slot[slot].from = anim->slot[slot].to;
+        anim->slot[slot].to = n;
+        anim->slot[slot].start = now;
+        anim->slot[slot].effect = effect;
+        anim->slot[slot].active = true;
+    }
+
+    if(anim->slot[slot].active && now - anim->slot[slot].start >= ANIM_DURATION) {
+        anim->slot[slot].active = false;
+    }
+    if(!anim->slot[slot].active) {
+        memcpy(rows, glyph[n], ANIM_ROWS);
+        return;
+    }
+
+    step = (int)((now - anim->slot[slot].start)
+                 * (uint64_t)steps(anim->slot[slot].effect) / ANIM_DURATION);
+    frame(anim, slot, step, rows);
+    anim->last = now;
+
+    return;
+}
+
+
+bool
+anim_active(const anim_t *anim)
+{
+    int i;
+
+    for(i = 0; i < ANIM_SLOTS; ++i) {
+        if(anim->slot[i].active) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * Shorten the wait to the next step of a transition. Returns true if it did.
+ */
+bool
+anim_timeout(const anim_t *anim, uint64_t now, struct timespec *length)
+{
+    const uint64_t wait = (uint64_t)length->tv_sec * 1000000000 + (uint64_t)length->tv_nsec;
+    uint64_t next = 0, at, step;
+    int n, i;
+
+    for(i = 0; i < ANIM_SLOTS; ++i) {
+        if(!anim->slot[i].active) {
+            continue;
+        }
+        n = steps(anim->slot[i].effect);
+        step = (now - anim->slot[i].start) * (uint64_t)n / ANIM_DURATION + 1;
+        at = anim->slot[i].start + (step * ANIM_DURATION + (uint64_t)n - 1) / (uint64_t)n;
+        if(at < anim->last + anim->interval) {
+            at = anim->last + anim->interval;
+        }
+        /* The last frame is never skipped */
+        if(at > anim->slot[i].start + ANIM_DURATION) {
+            at = anim->slot[i].start + ANIM_DURATION;
+        }
+        if(!next || at < next) {
+            next = at;
+        }
+    }
+
+    if(!next || (next > now && next - now >= wait)) {
+        return false;
+    }
+
+    next = (next > now) ? next - now : 0;
+    length->tv_sec = (time_t)(next / 1000000000);
+    length->tv_nsec = (long)(next % 1000000000);
+
+    return true;
+}
+
+
+/**
+ * Account for the time and the bytes the last frame took, ns being the time
+ * to draw it plus the time the terminal takes to be written. The frame rate
+ * is halved while over budget and doubled again once well below it, so that
+ * a slow terminal or link gets fewer steps instead of falling behind.
+ */
+void
+anim_cost(anim_t *anim, uint64_t ns, size_t bytes)
+{
+    uint64_t interval = anim->interval;
+    const uint64_t floor = (uint64_t)bytes * ANIM_FRAME / ANIM_BYTES;
+
+    if(ns > ANIM_CPU) {
+        interval *= 2;
+    } else if(ns < ANIM_CPU / 2) {
+        interval /= 2;
+    }
+
+    if(interval < floor) {
+        interval = floor;
+    }
+    if(interval < ANIM_FRAME) {
+        interval = ANIM_FRAME;
+    }
+    if(interval > ANIM_DURATION) {
+        interval = ANIM_DURATION;
+    }
+    anim->interval = interval;
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
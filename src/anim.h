@@ -0,0 +1,82 @@
+/*
+ *     TTY-CLOCK anim.h file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#ifndef ANIM_H
+#define ANIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Digit transitions */
+#define ANIM_NONE     0
+#define ANIM_SLIDE    1
+#define ANIM_DISSOLVE 2
+#define ANIM_FLIP     3
+
+#define ANIM_SLOTS    6         /* hh:mm:ss */
+#define ANIM_ROWS     5         /* a glyph is 5 rows of 3 pixels */
+#define ANIM_COLS     3
+#define ANIM_DURATION 300000000 /* ns */
+#define ANIM_FRAME    16666667  /* ns, 60 fps at most */
+#define ANIM_CPU      2000000   /* ns a frame may take to draw and write */
+#define ANIM_BYTES    512       /* bytes a frame may take every ANIM_FRAME */
+
+/* Transitions of one clock */
+typedef struct {
+    struct {
+        int from, to;
+        uint64_t start;
+        int effect;
+        bool active;
+        bool ready;
+    } slot[ANIM_SLOTS];
+    uint64_t interval; /* ns between two frames, grows when over budget */
+    uint64_t last;     /* time of the last frame */
+} anim_t;
+
+int anim_effect(const char *name);
+void anim_init(const bool glyphs[][ANIM_ROWS * ANIM_COLS]);
+void anim_reset(anim_t *anim);
+void anim_rows(int n, uint8_t rows[ANIM_ROWS]);
+void anim_glyph(anim_t *anim, int slot, int n, int effect, uint64_t now, uint8_t rows[ANIM_ROWS]);
+bool anim_active(const anim_t *anim);
+bool anim_timeout(const anim_t *anim, uint64_t now, struct timespec *length);
+void anim_cost(anim_t *anim, uint64_t ns, size_t bytes);
+
+#endif /* ANIM_H */
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,308 @@
+/*
+ *     TTY-CLOCK config.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include "anim.h"
+#include "config.h"
+
+
+/* Prototypes */
+static char *trim(char *str);
+static bool parse_bool(const char *val, bool *b);
+static bool parse_long(const char *val, long min, long max, long *num);
+static const char *base_name(const char *path);
+
+
+/**
+ * Strip leading and trailing blanks and a pair of enclosing quotes
+ */
+static char *
+trim(char *str)
+{
+    char *end;
+
+    while(*str == ' ' || *str == '\t') {
+        ++str;
+    }
+
+    end = str + strlen(str);
+    while(end > str && (end[-1] == ' ' || end[-1] == '\t'
+                        || end[-1] == '\n' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+
+    if(end - str >= 2 && *str == '"' && end[-1] == '"') {
+        end[-1] = '\0';
+        ++str;
+    }
+
+    return str;
+}
+
+
+static bool
+parse_bool(const char *val, bool *b)
+{
+    if(!strcmp(val, "1") || !strcmp(val, "true")
+       || !strcmp(val, "yes") || !strcmp(val, "on")) {
+        *b = true;
+
+        return true;
+    }
+    if(!strcmp(val, "0") || !strcmp(val, "false")
+       || !strcmp(val, "no") || !strcmp(val, "off")) {
+        *b = false;
+
+        return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * A decimal number in [min, max), nothing else may follow it
+ */
+static bool
+parse_long(const char *val, long min, long max, long *num)
+{
+    char *end;
+    long n;
+
+    errno = 0;
+    n = strtol(val, &end, 10);
+    if(end == val || *end || errno || n < min || n >= max) {
+        return false;
+    }
+    *num = n;
+
+    return true;
+}
+
+
+static const char *
+base_name(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+
+    return (slash) ? slash + 1 : path;
+}
+
+
+/**
+ * Default config file: $XDG_CONFIG_HOME/tty-clock/config or
+ * ~/.config/tty-clock/config
+ */
+char *
+config_path(void)
+{
+    const char *xdg = getenv("XDG_CONFIG_HOME");
+    const char *home = getenv("HOME");
+    char path[PATH_MAX];
+
+    if(xdg && *xdg) {
+        snprintf(path, sizeof(path), "%s/%s", xdg, CONFIG_FILE);
+    } else if(home && *home) {
+        snprintf(path, sizeof(path), "%s/.config/%s", home, CONFIG_FILE);
+    } else {
+        return NULL;
+    }
+
+    return strdup(path);
+}
+
+
+/**
+ * Read 'key = value' lines into the option set. Keys which are missing or
+ * invalid leave the current value untouched.
+ */
+bool
+config_load(const char *path, option_t *opt)
+{
+    FILE *file;
+    char line[CONFIG_LINE_SIZE];
+    char *key, *val, *eq;
+    long num;
+    bool b;
+
+    if(!(file = fopen(path, "r"))) {
+        return false;
+    }
+
+    while(fgets(line, sizeof(line), file)) {
+        key = trim(line);
+        if(*key == '#' || !(eq = strchr(key, '='))) {
+            continue;
+        }
+        *eq = '\0';
+        key = trim(key);
+        val = trim(eq + 1);
+
+        if(!strcmp(key, "format")) {
+            memset(opt->format, 0, FORMAT_SIZE);
+            strncpy(opt->format, val, FORMAT_SIZE - 1);
+        } else if(!strcmp(key, "color")) {
+            if(parse_long(val, 0, 8, &num)) {
+                opt->color = (short)num;
+            }
+        } else if(!strcmp(key, "effect")) {
+            if((num = anim_effect(val)) >= 0) {
+                opt->effect = (short)num;
+            }
+        } else if(!strcmp(key, "delay")) {
+            if(parse_long(val, 0, DELAY_MAX, &num)) {
+                opt->delay = num;
+            }
+        } else if(!strcmp(key, "nsdelay")) {
+            if(parse_long(val, 0, DELAYNS_MAX, &num)) {
+                opt->nsdelay = num;
+            }
+        } else if(!strcmp(key, "status")) {
+            if(parse_long(val, 0, DELAY_MAX, &num)) {
+                opt->status = num;
+            }
+        } else if(!parse_bool(val, &b)) {
+            continue;
+        } else if(!strcmp(key, "second")) {
+            opt->second = b;
+        } else if(!strcmp(key, "screensaver")) {
+            opt->screensaver = b;
+        } else if(!strcmp(key, "twelve")) {
+            opt->twelve = b;
+        } else if(!strcmp(key, "center")) {
+            opt->center = b;
+        } else if(!strcmp(key, "rebound")) {
+            opt->rebound = b;
+        } else if(!strcmp(key, "date")) {
+            opt->date = b;
+        } else if(!strcmp(key, "utc")) {
+            opt->utc = b;
+        } else if(!strcmp(key, "box")) {
+            opt->box = b;
+        } else if(!strcmp(key, "noquit")) {
+            opt->noquit = b;
+        } else if(!strcmp(key, "bold")) {
+            opt->bold = b;
+        } else if(!strcmp(key, "blink")) {
+            opt->blink = b;
+        } else if(!strcmp(key, "analog")) {
+            opt->analog = b;
+        } else if(!strcmp(key, "sixel")) {
+            opt->sixel = b;
+        } else if(!strcmp(key, "pause")) {
+            opt->pause = b;
+        }
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+
+/**
+ * Watch the directory of the config file, so that editors which replace the
+ * file instead of rewriting it are noticed too. Returns the fd to wait on.
+ */
+int
+config_watch(const char *path)
+{
+#ifdef __linux__
+    char dir[PATH_MAX];
+    const char *name = base_name(path);
+    int fd;
+
+    if(name == path) {
+        strncpy(dir, ".", sizeof(dir));
+    } else {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(name - path - 1), path);
+    }
+
+    if((fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+        return -1;
+    }
+    if(inotify_add_watch(fd, (*dir) ? dir : "/", IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+        close(fd);
+
+        return -1;
+    }
+
+    return fd;
+#else
+    (void)path;
+
+    return -1;
+#endif
+}
+
+
+/**
+ * Drain the pending events, true if one of them concerns the config file
+ */
+bool
+config_changed(int fd, const char *path)
+{
+    bool changed = false;
+#ifdef __linux__
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev;
+    const char *name = base_name(path);
+    ssize_t len;
+    char *p;
+
+    while((len = read(fd, buf, sizeof(buf))) > 0) {
+        for(p = buf; p < buf + len; p += sizeof(struct inotify_event) + ev->len) {
+            ev = (const struct inotify_event *)p;
+            if(ev->len && !strcmp(ev->name, name)) {
+                changed = true;
+            }
+        }
+    }
+#else
+    (void)fd;
+    (void)path;
+#endif
+
+    return changed;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,291 @@
+/*
+ *     TTY-CLOCK input.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <ncurses.h>
+#include "input.h"
+
+/* Decoder state */
+enum {
+    INPUT_GROUND,
+    INPUT_ESC,
+    INPUT_CSI,
+    INPUT_SS3,
+};
+
+/*
+ * Keys from the input thread to the render thread. Single producer, single
+ * consumer: each index is only written by one side, so no lock is needed.
+ */
+static struct {
+    int key[INPUT_QUEUE_SIZE];
+    unsigned int tail; /* written by the input thread */
+    char pad_tail[INPUT_CACHELINE - sizeof(unsigned int)];
+    unsigned int head; /* written by the render thread */
+    char pad_head[INPUT_CACHELINE - sizeof(unsigned int)];
+} queue;
+
+/* Input thread */
+static struct {
+    pthread_t thread;
+    pthread_t main;
+    bool running;
+    int fd;
+    int wake[2]; /* readable while keys are queued */
+    bool (*quit)(int key);
+} input = { .wake = {-1, -1} };
+
+
+/* Prototypes */
+static void push(int key);
+static int decode(int *state, unsigned char ch);
+static void *input_thread(void *arg);
+
+
+/**
+ * Queue a key and wake the render thread, the key is dropped if the queue is
+ * full
+ */
+static void
+push(int key)
+{
+    const unsigned int tail = __atomic_load_n(&queue.tail, __ATOMIC_RELAXED);
+    const unsigned int head = __atomic_load_n(&queue.head, __ATOMIC_ACQUIRE);
+    const char c = 0;
+
+    if(tail - head < INPUT_QUEUE_SIZE) {
+        queue.key[tail & (INPUT_QUEUE_SIZE - 1)] = key;
+        __atomic_store_n(&queue.tail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    if(write(input.wake[1], &c, 1) == -1) {
+        /* pipe full, the render thread is awake anyway */
+    }
+
+    return;
+}
+
+
+/**
+ * Feed one byte to the decoder, returns a key or ERR while a sequence is
+ * incomplete or unknown
+ */
+static int
+decode(int *state, unsigned char ch)
+{
+    switch(*state) {
+    case INPUT_ESC:
+        *state = (ch == '[') ? INPUT_CSI : (ch == 'O') ? INPUT_SS3 : INPUT_GROUND;
+        return ERR;
+    case INPUT_CSI:
+        /* parameters and intermediates until the final byte */
+        if(ch < 0x40 || ch > 0x7E) {
+            return ERR;
+        }
+        if(ch == 'I' || ch == 'O') {
+            *state = INPUT_GROUND;
+            return (ch == 'I') ? INPUT_FOCUS_IN : INPUT_FOCUS_OUT;
+        }
+        /* FALLTHROUGH */
+    case INPUT_SS3:
+        *state = INPUT_GROUND;
+        switch(ch) {
+        case 'A':
+            return KEY_UP;
+        case 'B':
+            return KEY_DOWN;
+        case 'C':
+            return KEY_RIGHT;
+        case 'D':
+            return KEY_LEFT;
+        }
+        return ERR;
+    }
+
+    if(ch == 0x1B) {
+        *state = INPUT_ESC;
+
+        return ERR;
+    }
+
+    return ch;
+}
+
+
+static void *
+input_thread(void *arg)
+{
+    int state = INPUT_GROUND;
+    unsigned char buf[64];
+    ssize_t len, i;
+    int key;
+
+    (void)arg;
+
+    while((len = read(input.fd, buf, sizeof(buf))) != 0) {
+        if(len == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for(i = 0; i < len; ++i) {
+            if((key = decode(&state, buf[i])) == ERR) {
+                continue;
+            }
+            /* Quit at once, even if the render thread is busy */
+            if(key != INPUT_FOCUS_IN && key != INPUT_FOCUS_OUT && input.quit(key)) {
+                pthread_kill(input.main, SIGTERM);
+            }
+            push(key);
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Start reading and decoding keys from fd in a thread of its own. The quit
+ * callback is asked for every key but the focus reports, SIGTERM is sent to
+ * the calling thread if it returns true.
+ */
+bool
+input_start(int fd, bool (*quit)(int key))
+{
+    sigset_t all, old;
+    int i, ret;
+
+    if(pipe(input.wake) == -1) {
+        return false;
+    }
+    for(i = 0; i < 2; ++i) {
+        fcntl(input.wake[i], F_SETFL, fcntl(input.wake[i], F_GETFL) | O_NONBLOCK);
+        fcntl(input.wake[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    input.fd = fd;
+    input.quit = quit;
+    input.main = pthread_self();
+
+    /* Signals are handled by the render thread only */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    ret = pthread_create(&input.thread, NULL, input_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if(ret != 0) {
+        input_stop();
+
+        return false;
+    }
+    input.running = true;
+
+    return true;
+}
+
+
+/**
+ * fd to wait on for new keys
+ */
+int
+input_wakefd(void)
+{
+    return input.wake[0];
+}
+
+
+/**
+ * Empty the wake pipe, to be done before draining the queue
+ */
+void
+input_clear(void)
+{
+    char buf[64];
+
+    while(read(input.wake[0], buf, sizeof(buf)) > 0);
+
+    return;
+}
+
+
+/**
+ * Next queued key or ERR
+ */
+int
+input_get(void)
+{
+    const unsigned int head = __atomic_load_n(&queue.head, __ATOMIC_RELAXED);
+    const unsigned int tail = __atomic_load_n(&queue.tail, __ATOMIC_ACQUIRE);
+    int key;
+
+    if(head == tail) {
+        return ERR;
+    }
+
+    key = queue.key[head & (INPUT_QUEUE_SIZE - 1)];
+    __atomic_store_n(&queue.head, head + 1, __ATOMIC_RELEASE);
+
+    return key;
+}
+
+
+void
+input_stop(void)
+{
+    int i;
+
+    if(input.running) {
+        pthread_cancel(input.thread);
+        pthread_join(input.thread, NULL);
+        input.running = false;
+    }
+
+    for(i = 0; i < 2; ++i) {
+        if(input.wake[i] >= 0) {
+            close(input.wake[i]);
+            input.wake[i] = -1;
+        }
+    }
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,657 @@
+/*
+ *     TTY-CLOCK output.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#include <sys/select.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include <ncurses.h>
+#include "output.h"
+#include "record.h"
+#include "rep.h"
+#include "stats.h"
+#include "trace.h"
+
+/* Set in writer.pending while the writer hasn't taken the frame */
+#define OUTPUT_FRESH 0x100u
+
+/* A complete frame, escape sequences included */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    uint64_t queued; /* monotonic ns output_flush() handed it over */
+    unsigned int gen; /* output_cancel() calls before it was queued */
+} frame_t;
+
+/* Frame output */
+static struct {
+    FILE *file;  /* ncurses renders into this file */
+    int fd;      /* the terminal */
+    bool sync;   /* wrap every frame in a synchronized update */
+    bool sixel;  /* the terminal draws sixel graphics */
+    bool rep;    /* runs are sent as one character and REP (CSI n b) */
+    rep_t runs;  /* character sets, REP is left alone out of ASCII */
+    int cellw;   /* size of a cell in pixels, 0 if unknown */
+    int cellh;
+    size_t last; /* bytes of the last frame */
+} output;
+
+/*
+ * Frames from the render thread to the writer thread. The render thread
+ * fills back, the writer writes front, and the newest complete frame waits
+ * in pending. Only pending is shared and it is swapped atomically. While a
+ * frame waits the render thread doesn't render another (see output_busy()),
+ * only the last frame at exit may take its place.
+ */
+static struct {
+    frame_t frame[OUTPUT_FRAMES];
+    unsigned int pending; /* index, with OUTPUT_FRESH until it is taken */
+    unsigned int back;    /* render thread */
+    unsigned int front;   /* writer thread */
+    bool writing;         /* set by the writer while it has a frame */
+    bool broken;          /* set by the writer if a frame was cut short */
+    uint64_t since;       /* when the frame being written was queued, 0 if none */
+    uint64_t latency;     /* ns the last written frame took, see output_latency() */
+    bool running;
+    sem_t wake;
+    pthread_t thread;
+} writer;
+
+/*
+ * Counted up from signal handlers to give up the frames queued before. It is
+ * never reset, so a request can't be lost between two frames.
+ */
+static unsigned int cancel;
+
+
+/* Prototypes */
+static FILE *render_file(void);
+static bool write_all(const char *buf, size_t len, unsigned int gen);
+static void *writer_thread(void *arg);
+static void writer_wait(long ns);
+static void writer_stop(void);
+static bool da1_sixel(const char *reply);
+static bool cpr_rep(const char *reply);
+
+
+/**
+ * File for ncurses to render into. On Linux it only lives in memory, so a
+ * frame never touches the disk holding /tmp.
+ */
+static FILE *
+render_file(void)
+{
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    FILE *file;
+    int fd;
+
+    if((fd = memfd_create("tty-clock", MFD_CLOEXEC)) != -1) {
+        if((file = fdopen(fd, "w+"))) {
+            return file;
+        }
+        close(fd);
+    }
+#endif
+
+    return tmpfile();
+}
+
+
+/**
+ * Write the whole buffer. A signal since gen gives up the rest, so that a
+ * terminal which doesn't read doesn't keep quit or resize from being handled.
+ */
+static bool
+write_all(const char *buf, size_t len, unsigned int gen)
+{
+    ssize_t n;
+    int state;
+
+    while(len) {
+        if(__atomic_load_n(&cancel, __ATOMIC_SEQ_CST) != gen) {
+            return false;
+        }
+        /* The writer can only be stopped while it waits for the terminal */
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &state);
+        n = write(output.fd, buf, len);
+        pthread_setcancelstate(state, NULL);
+        if(n == -1) {
+            return false;
+        }
+        record_output(buf, (size_t)n);
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return true;
+}
+
+
+/**
+ * Write the frames queued by output_flush(), so that a terminal which reads
+ * slowly or not at all never holds up the render thread
+ */
+static void *
+writer_thread(void *arg)
+{
+    unsigned int taken;
+    const frame_t *frame;
+    uint64_t ns, span;
+    bool ok;
+
+    (void)arg;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    for(;;) {
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        while(sem_wait(&writer.wake) == -1 && errno == EINTR);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+        __atomic_store_n(&writer.writing, true, __ATOMIC_SEQ_CST);
+        taken = __atomic_exchange_n(&writer.pending, writer.front, __ATOMIC_SEQ_CST);
+        writer.front = taken & ~OUTPUT_FRESH;
+        if(taken & OUTPUT_FRESH) {
+            frame = &writer.frame[writer.front];
+            __atomic_store_n(&writer.since, frame->queued, __ATOMIC_RELAXED);
+            span = trace_begin();
+            ok = write_all(frame->buf, frame->len, frame->gen);
+            trace_end("write", span);
+            if(!ok) {
+                __atomic_store_n(&writer.broken, true, __ATOMIC_SEQ_CST);
+            } else {
+                ns = trace_clock() - frame->queued;
+                __atomic_store_n(&writer.latency, ns, __ATOMIC_RELAXED);
+                stats_write(ns);
+            }
+            __atomic_store_n(&writer.since, 0, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&writer.writing, false, __ATOMIC_SEQ_CST);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Wait up to ns for the writer to have written every queued frame
+ */
+static void
+writer_wait(long ns)
+{
+    const struct timespec step = {0, 1000000};
+    long waited;
+
+    for(waited = 0; waited < ns; waited += step.tv_nsec) {
+        if(!(__atomic_load_n(&writer.pending, __ATOMIC_SEQ_CST) & OUTPUT_FRESH)
+           && !__atomic_load_n(&writer.writing, __ATOMIC_SEQ_CST)) {
+            break;
+        }
+        nanosleep(&step, NULL);
+    }
+
+    return;
+}
+
+
+static void
+writer_stop(void)
+{
+    if(writer.running) {
+        pthread_cancel(writer.thread);
+        pthread_join(writer.thread, NULL);
+        sem_destroy(&writer.wake);
+        writer.running = false;
+    }
+
+    return;
+}
+
+
+/**
+ * Whether the DA1 reply (CSI ? Ps ; ... c) lists attribute 4, sixel
+ */
+static bool
+da1_sixel(const char *reply)
+{
+    const char *p = strstr(reply, "\033[?");
+    long attr;
+    char *end;
+
+    if(!p) {
+        return false;
+    }
+    for(p += 3; *p && *p != 'c'; p = end) {
+        attr = strtol(p, &end, 10);
+        if(end == p) {
+            return false;
+        }
+        if(attr == 4) {
+            return true;
+        }
+        if(*end == ';') {
+            ++end;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * Whether the cursor position report (CSI row ; col R) shows that the blank
+ * of the query was repeated
+ */
+static bool
+cpr_rep(const char *reply)
+{
+    const char *p;
+    int row, col, end;
+
+    for(p = strchr(reply, '\033'); p; p = strchr(p + 1, '\033')) {
+        end = 0;
+        if(sscanf(p, "\033[%d;%dR%n", &row, &col, &end) == 2 && end) {
+            return (col == 3);
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * Returns the file ncurses has to render into. Nothing reaches the terminal
+ * fd until output_flush() queues the whole frame for the writer thread.
+ */
+FILE *
+output_open(int fd)
+{
+    bool ready = true;
+    unsigned int i;
+
+    output.fd = fd;
+    output.file = render_file();
+    for(i = 0; i < OUTPUT_FRAMES; ++i) {
+        writer.frame[i].size = OUTPUT_BUF_SIZE;
+        ready = (writer.frame[i].buf = malloc(OUTPUT_BUF_SIZE)) && ready;
+    }
+    writer.back = 0;
+    writer.pending = 1;
+    writer.front = 2;
+
+    if(!ready || !output.file) {
+        output_close();
+
+        return NULL;
+    }
+
+    return output.file;
+}
+
+
+/**
+ * Start the writer thread. It inherits the scheduling policy and cpu of the
+ * calling thread, so it has to come after rt_start().
+ */
+bool
+output_start(void)
+{
+    sigset_t all, old;
+    int ret;
+
+    if(writer.running) {
+        return true;
+    }
+    if(sem_init(&writer.wake, 0, 0) == -1) {
+        return false;
+    }
+
+    /* Signals are handled by the render thread only */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    ret = pthread_create(&writer.thread, NULL, writer_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if(ret != 0) {
+        sem_destroy(&writer.wake);
+        errno = ret;
+
+        return false;
+    }
+    writer.running = true;
+
+    return true;
+}
+
+
+/**
+ * Size of the terminal, ncurses can't ask for it as it doesn't write to it.
+ * The cell size follows if the terminal reports pixels.
+ */
+bool
+output_size(int *lines, int *cols)
+{
+    struct winsize ws;
+
+    if(ioctl(output.fd, TIOCGWINSZ, &ws) == -1 || !ws.ws_row || !ws.ws_col) {
+        return false;
+    }
+
+    *lines = ws.ws_row;
+    *cols = ws.ws_col;
+    if(ws.ws_xpixel && ws.ws_ypixel) {
+        output.cellw = ws.ws_xpixel / ws.ws_col;
+        output.cellh = ws.ws_ypixel / ws.ws_row;
+    }
+
+    return true;
+}
+
+
+/**
+ * Ask the terminal what it can do. Synchronized output is used if terminfo
+ * has the 'Sync' capability or the terminal reports mode 2026 as known.
+ * REP is used if terminfo has 'rep', or if rep asks to try it and the cursor
+ * moved as if it was known.
+ * Sixel support comes from DA1, the cell size from the window size or else
+ * from CSI 16 t. DA1 is sent last and every terminal answers it, so there is
+ * no need to wait for the timeout on terminals which ignore the rest.
+ */
+bool
+output_query(int infd, bool rep)
+{
+    const struct timespec wait = {0, OUTPUT_QUERY_WAIT};
+    const char *cap = tigetstr("Sync");
+    const char *cap_rep = tigetstr("rep");
+    const unsigned int gen = __atomic_load_n(&cancel, __ATOMIC_SEQ_CST);
+    char buf[256] = "";
+    struct winsize ws;
+    const char *p;
+    size_t len = 0;
+    ssize_t n;
+    fd_set rfds;
+
+    output.rep = (cap_rep && cap_rep != (char *)-1);
+    if(rep && !output.rep
+       && !write_all(OUTPUT_QUERY_REP, sizeof(OUTPUT_QUERY_REP) - 1, gen)) {
+        return false;
+    }
+    if(!write_all(OUTPUT_QUERY, sizeof(OUTPUT_QUERY) - 1, gen)) {
+        return false;
+    }
+
+    while(len < sizeof(buf) - 1 && !strchr(buf, 'c')) {
+        FD_ZERO(&rfds);
+        FD_SET(infd, &rfds);
+        if(pselect(infd + 1, &rfds, NULL, NULL, &wait, NULL) <= 0
+           || (n = read(infd, buf + len, sizeof(buf) - 1 - len)) <= 0) {
+            break;
+        }
+        len += (size_t)n;
+        buf[len] = '\0';
+    }
+    buf[len] = '\0';
+
+    output.sync = ((cap && cap != (char *)-1)
+                   || strstr(buf, "\033[?2026;1$y") || strstr(buf, "\033[?2026;2$y"));
+    output.sixel = da1_sixel(buf);
+    output.rep = output.rep || (rep && cpr_rep(buf));
+
+    if(ioctl(output.fd, TIOCGWINSZ, &ws) == 0 && ws.ws_xpixel && ws.ws_ypixel
+       && ws.ws_col && ws.ws_row) {
+        output.cellw = ws.ws_xpixel / ws.ws_col;
+        output.cellh = ws.ws_ypixel / ws.ws_row;
+    } else if((p = strstr(buf, "\033[6;"))
+              && sscanf(p, "\033[6;%d;%dt", &output.cellh, &output.cellw) != 2) {
+        output.cellw = output.cellh = 0;
+    }
+
+    return output.sync;
+}
+
+
+/**
+ * Whether sixel graphics can be drawn, with the size of a cell in pixels
+ */
+bool
+output_sixel(int *cellw, int *cellh)
+{
+    *cellw = output.cellw;
+    *cellh = output.cellh;
+
+    return (output.sixel && output.cellw > 0 && output.cellh > 0);
+}
+
+
+/**
+ * Add bytes after what ncurses rendered, they go out with the same frame
+ */
+void
+output_append(const char *buf, size_t len)
+{
+    if(output.file) {
+        fwrite(buf, 1, len, output.file);
+    }
+
+    return;
+}
+
+
+/**
+ * Have the terminal report focus changes to the input, or stop it, with the
+ * next frame
+ */
+void
+output_focus(bool on)
+{
+    if(on) {
+        output_append(OUTPUT_FOCUS_ON, sizeof(OUTPUT_FOCUS_ON) - 1);
+    } else {
+        output_append(OUTPUT_FOCUS_OFF, sizeof(OUTPUT_FOCUS_OFF) - 1);
+    }
+
+    return;
+}
+
+
+/**
+ * Whether the writer hasn't taken the last frame yet. The caller should leave
+ * the changes with ncurses then, so that its next update covers them and the
+ * terminal only ever gets the newest state.
+ */
+bool
+output_busy(void)
+{
+    return (__atomic_load_n(&writer.pending, __ATOMIC_SEQ_CST) & OUTPUT_FRESH);
+}
+
+
+/**
+ * Queue everything ncurses has rendered since the last call as one frame,
+ * inside a synchronized update if the terminal supports it and with runs
+ * shortened by REP if it knows REP. The writer thread sends it with a single
+ * write(). Returns false if the next frame has to redraw everything, as the
+ * last one was cut short or had to be replaced before it was written.
+ */
+bool
+output_flush(void)
+{
+    const size_t pre = (output.sync) ? sizeof(OUTPUT_BSU) - 1 : 0;
+    const size_t post = (output.sync) ? sizeof(OUTPUT_ESU) - 1 : 0;
+    frame_t *frame = &writer.frame[writer.back];
+    bool done = false;
+    unsigned int old;
+    size_t need, body;
+    off_t len;
+    char *buf;
+    int fd;
+
+    if(!output.file) {
+        return true;
+    }
+
+    fflush(output.file);
+    fd = fileno(output.file);
+    if((len = lseek(fd, 0, SEEK_END)) <= 0) {
+        output.last = 0;
+        return true;
+    }
+
+    need = pre + (size_t)len + post;
+    if(need > frame->size) {
+        if((buf = realloc(frame->buf, need))) {
+            frame->buf = buf;
+            frame->size = need;
+        }
+    }
+
+    output.last = need;
+    if(need <= frame->size && pread(fd, frame->buf + pre, (size_t)len, 0) == len) {
+        body = (output.rep) ? rep_encode(&output.runs, frame->buf + pre, (size_t)len) : (size_t)len;
+        output.last = frame->len = pre + body + post;
+        memcpy(frame->buf, OUTPUT_BSU, pre);
+        memcpy(frame->buf + pre + body, OUTPUT_ESU, post);
+        done = !__atomic_exchange_n(&writer.broken, false, __ATOMIC_SEQ_CST);
+
+        frame->queued = trace_clock();
+        frame->gen = __atomic_load_n(&cancel, __ATOMIC_SEQ_CST);
+        old = __atomic_exchange_n(&writer.pending, writer.back | OUTPUT_FRESH, __ATOMIC_SEQ_CST);
+        writer.back = old & ~OUTPUT_FRESH;
+        if(old & OUTPUT_FRESH) {
+            /* The terminal never got it, so this frame's diff isn't enough */
+            stats_drop();
+            done = false;
+        }
+        sem_post(&writer.wake);
+    }
+
+    if(ftruncate(fd, 0) == 0) {
+        rewind(output.file);
+    }
+
+    return done;
+}
+
+
+/**
+ * Size of the last frame written
+ */
+size_t
+output_bytes(void)
+{
+    return output.last;
+}
+
+
+/**
+ * Time the terminal takes to get a frame, from output_flush() to the end of
+ * its write(). A frame still being written counts for as long as it has
+ * taken so far, so that a terminal which stopped reading shows up at once.
+ */
+uint64_t
+output_latency(void)
+{
+    const uint64_t since = __atomic_load_n(&writer.since, __ATOMIC_RELAXED);
+    const uint64_t latency = __atomic_load_n(&writer.latency, __ATOMIC_RELAXED);
+    const uint64_t now = trace_clock();
+
+    return (since && now > since && now - since > latency) ? now - since : latency;
+}
+
+
+/**
+ * Last flush before exit. The writer gets OUTPUT_FINISH to catch up and
+ * write it, and is stopped after that even if the terminal doesn't read.
+ */
+void
+output_finish(void)
+{
+    /* Even if tty-clock ends before it started, the terminal needs the frame */
+    if(!output.file || !output_start()) {
+        return;
+    }
+
+    writer_wait(OUTPUT_FINISH / 2);
+    /* What the terminal is left with matters more than a frame it never got */
+    output_flush();
+    writer_wait(OUTPUT_FINISH / 2);
+    writer_stop();
+
+    return;
+}
+
+
+/**
+ * Stop writing the frames queued so far, safe to call from a signal handler
+ * as the atomic is lock-free
+ */
+void
+output_cancel(void)
+{
+    __atomic_add_fetch(&cancel, 1, __ATOMIC_SEQ_CST);
+
+    return;
+}
+
+
+void
+output_close(void)
+{
+    unsigned int i;
+
+    writer_stop();
+    if(output.file) {
+        fclose(output.file);
+    }
+    for(i = 0; i < OUTPUT_FRAMES; ++i) {
+        free(writer.frame[i].buf);
+    }
+    memset(&output, 0, sizeof(output));
+    memset(&writer, 0, sizeof(writer));
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,78 @@
+/*
+ *     TTY-CLOCK output.h file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* DEC private mode 2026, synchronized output */
+#define OUTPUT_BSU        "\033[?2026h"
+#define OUTPUT_ESU        "\033[?2026l"
+/* DEC private mode 1004, focus reports */
+#define OUTPUT_FOCUS_ON   "\033[?1004h"
+#define OUTPUT_FOCUS_OFF  "\033[?1004l"
+/*
+ * REP, with -Q only as it shows on the line: a blank repeated once must leave
+ * the cursor in column 3 (CPR), the line is cleared again
+ */
+#define OUTPUT_QUERY_REP  "\r \033[b\033[6n\r\033[K"
+/* Mode 2026, the cell size in pixels and DA1, which lists sixel as 4 */
+#define OUTPUT_QUERY      "\033[?2026$p\033[16t\033[c"
+#define OUTPUT_QUERY_WAIT 200000000 /* ns */
+#define OUTPUT_BUF_SIZE   65536
+#define OUTPUT_FRAMES     3         /* written, waiting and being rendered */
+#define OUTPUT_FINISH     100000000 /* ns the last frame may take at exit */
+
+FILE *output_open(int fd);
+bool output_start(void);
+bool output_size(int *lines, int *cols);
+bool output_query(int infd, bool rep);
+bool output_sixel(int *cellw, int *cellh);
+void output_append(const char *buf, size_t len);
+void output_focus(bool on);
+bool output_busy(void);
+bool output_flush(void);
+size_t output_bytes(void);
+uint64_t output_latency(void);
+void output_finish(void);
+void output_cancel(void);
+void output_close(void);
+
+#endif /* OUTPUT_H */
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
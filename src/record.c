@@ -0,0 +1,201 @@
+/*
+ *     TTY-CLOCK record.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "record.h"
+
+/*
+ * Recording of everything written to the terminal. The output is recorded by
+ * the writer thread and resizes by the render thread, so every event holds
+ * the file's lock while it is written, time included.
+ */
+static struct {
+    FILE *file;
+    struct timespec start;
+} record;
+
+
+/* Prototypes */
+static double elapsed(void);
+static void put_string(const char *buf, size_t len);
+
+
+/**
+ * Seconds since the recording started
+ */
+static double
+elapsed(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)(now.tv_sec - record.start.tv_sec)
+           + (double)(now.tv_nsec - record.start.tv_nsec) / 1e9;
+}
+
+
+/**
+ * Write the bytes as a JSON string. Bytes from 0x80 up are copied, the
+ * terminal output is UTF-8.
+ */
+static void
+put_string(const char *buf, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    size_t i;
+
+    putc('"', record.file);
+    for(i = 0; i < len; ++i) {
+        switch(p[i]) {
+        case '"':
+            fputs("\\\"", record.file);
+            break;
+        case '\\':
+            fputs("\\\\", record.file);
+            break;
+        case '\n':
+            fputs("\\n", record.file);
+            break;
+        case '\r':
+            fputs("\\r", record.file);
+            break;
+        default:
+            if(p[i] < 0x20 || p[i] == 0x7f) {
+                fprintf(record.file, "\\u%04x", p[i]);
+            } else {
+                putc(p[i], record.file);
+            }
+            break;
+        }
+    }
+    putc('"', record.file);
+
+    return;
+}
+
+
+/**
+ * Open the file the terminal output is recorded to
+ */
+bool
+record_init(const char *path)
+{
+    if(!(record.file = fopen(path, "w"))) {
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Write the header, the timestamps of the events are relative to this call
+ */
+void
+record_start(int cols, int lines)
+{
+    const char *term = getenv("TERM");
+
+    if(!record.file) {
+        return;
+    }
+
+    flockfile(record.file);
+    clock_gettime(CLOCK_MONOTONIC, &record.start);
+    fprintf(record.file,
+            "{\"version\": %d, \"width\": %d, \"height\": %d, \"timestamp\": %lld, \"env\": {\"TERM\": ",
+            RECORD_VERSION, cols, lines, (long long)time(NULL));
+    put_string((term) ? term : "", (term) ? strlen(term) : 0);
+    fputs("}}\n", record.file);
+    fflush(record.file);
+    funlockfile(record.file);
+
+    return;
+}
+
+
+/**
+ * Record bytes written to the terminal, flushed at once so that nothing is
+ * lost if tty-clock is killed
+ */
+void
+record_output(const char *buf, size_t len)
+{
+    if(!record.file || !len) {
+        return;
+    }
+
+    flockfile(record.file);
+    fprintf(record.file, "[%.6f, \"o\", ", elapsed());
+    put_string(buf, len);
+    fputs("]\n", record.file);
+    fflush(record.file);
+    funlockfile(record.file);
+
+    return;
+}
+
+
+void
+record_resize(int cols, int lines)
+{
+    if(!record.file) {
+        return;
+    }
+
+    flockfile(record.file);
+    fprintf(record.file, "[%.6f, \"r\", \"%dx%d\"]\n", elapsed(), cols, lines);
+    fflush(record.file);
+    funlockfile(record.file);
+
+    return;
+}
+
+
+void
+record_free(void)
+{
+    if(record.file) {
+        fclose(record.file);
+    }
+    record.file = NULL;
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
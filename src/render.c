@@ -0,0 +1,374 @@
+/*
+ *     TTY-CLOCK render.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#include "anim.h"
+#include "render.h"
+
+/* Number matrix */
+static const bool number[][15] = {
+    {1,1,1,1,0,1,1,0,1,1,0,1,1,1,1}, /* 0 */
+    {0,0,1,0,0,1,0,0,1,0,0,1,0,0,1}, /* 1 */
+    {1,1,1,0,0,1,1,1,1,1,0,0,1,1,1}, /* 2 */
+    {1,1,1,0,0,1,1,1,1,0,0,1,1,1,1}, /* 3 */
+    {1,0,1,1,0,1,1,1,1,0,0,1,0,0,1}, /* 4 */
+    {1,1,1,1,0,0,1,1,1,0,0,1,1,1,1}, /* 5 */
+    {1,1,1,1,0,0,1,1,1,1,0,1,1,1,1}, /* 6 */
+    {1,1,1,0,0,1,0,0,1,0,0,1,0,0,1}, /* 7 */
+    {1,1,1,1,0,1,1,1,1,1,0,1,1,1,1}, /* 8 */
+    {1,1,1,1,0,1,1,1,1,0,0,1,1,1,1}, /* 9 */
+};
+
+/* Column of each digit in the frame, they all start on row 1 */
+static const int digit_x[ANIM_SLOTS] = { 1, 8, 20, 27, 39, 46 };
+
+
+/* Prototypes */
+static void put(render_buf_t *buf, int x, int y, uint32_t ch, uint8_t color,
+                uint8_t attr, render_rect_t *rect);
+static void put_digit(render_t *r, render_buf_t *buf, int slot, int n, int x,
+                      int y, uint64_t now, render_rect_t *rect);
+static void put_colon(render_buf_t *buf, int x, int y, uint8_t color,
+                      uint8_t attr, render_rect_t *rect);
+static int collect(const render_rect_t *rects, int n, render_rect_t *dirty);
+
+
+/**
+ * Write a cell if it differs and grow the rectangle to cover it
+ */
+static void
+put(render_buf_t *buf, int x, int y, uint32_t ch, uint8_t color, uint8_t attr,
+    render_rect_t *rect)
+{
+    render_cell_t *cell;
+
+    if(x < 0 || y < 0 || x >= buf->w || y >= buf->h) {
+        return;
+    }
+
+    cell = &buf->cells[y * buf->w + x];
+    if(cell->ch == ch && cell->color == color && cell->attr == attr) {
+        return;
+    }
+    cell->ch = ch;
+    cell->color = color;
+    cell->attr = attr;
+
+    if(!rect->w) {
+        rect->x = x;
+        rect->y = y;
+        rect->w = rect->h = 1;
+        return;
+    }
+    if(x < rect->x) {
+        rect->w += rect->x - x;
+        rect->x = x;
+    } else if(x >= rect->x + rect->w) {
+        rect->w = x - rect->x + 1;
+    }
+    if(y < rect->y) {
+        rect->h += rect->y - y;
+        rect->y = y;
+    } else if(y >= rect->y + rect->h) {
+        rect->h = y - rect->y + 1;
+    }
+
+    return;
+}
+
+
+/**
+ * A digit is 5 rows of 3 pixels, each pixel two cells wide
+ */
+static void
+put_digit(render_t *r, render_buf_t *buf, int slot, int n, int x, int y,
+          uint64_t now, render_rect_t *rect)
+{
+    /* Bold blocks have always been drawn blinking, which most terminals show
+     * as a bright background */
+    const uint8_t attr = (r->bold) ? RENDER_BLINK : 0;
+    const uint8_t *rows = r->rows[slot];
+    int i, j;
+
+    /* The glyph, or a frame of its transition if the digit just changed */
+    anim_glyph(&r->anim, slot, n, r->effect, now, r->rows[slot]);
+
+    for(i = 0; i < ANIM_ROWS; ++i) {
+        for(j = 0; j < ANIM_COLS * 2; ++j) {
+            put(buf, x + j, y + i, ' ',
+                (!r->sprites && ((rows[i] >> (2 - j / 2)) & 1)) ? RENDER_BLOCK : RENDER_BLANK,
+                attr, rect);
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * 2 dots for number separation
+ */
+static void
+put_colon(render_buf_t *buf, int x, int y, uint8_t color, uint8_t attr,
+          render_rect_t *rect)
+{
+    put(buf, x, y + 1, ' ', color, attr, rect);
+    put(buf, x + 1, y + 1, ' ', color, attr, rect);
+    put(buf, x, y + 3, ' ', color, attr, rect);
+    put(buf, x + 1, y + 3, ' ', color, attr, rect);
+
+    return;
+}
+
+
+static int
+collect(const render_rect_t *rects, int n, render_rect_t *dirty)
+{
+    int i, count = 0;
+
+    for(i = 0; i < n; ++i) {
+        if(rects[i].w) {
+            dirty[count++] = rects[i];
+        }
+    }
+
+    return count;
+}
+
+
+void
+render_init(render_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->format = "%F";
+    anim_init(number);
+    anim_reset(&r->anim);
+
+    return;
+}
+
+
+/**
+ * Split the time into digits and format the date
+ */
+void
+render_time(render_t *r, time_t lt)
+{
+    char tmpstr[128];
+    int ihour;
+
+    r->lt = lt;
+    if(r->utc) {
+        gmtime_r(&(r->lt), &(r->tm));
+    } else {
+        localtime_r(&(r->lt), &(r->tm));
+    }
+
+    ihour = r->tm.tm_hour;
+
+    if(r->twelve) {
+        r->meridiem = ((ihour >= 12) ? RENDER_PMSIGN : RENDER_AMSIGN);
+    } else {
+        r->meridiem = "\0";
+    }
+
+    /* Manage hour for twelve mode */
+    ihour = ((r->twelve && ihour > 12)  ? (ihour - 12) : ihour);
+    ihour = ((r->twelve && !ihour) ? 12 : ihour);
+
+    /* Set hour */
+    r->date.hour[0] = ihour / 10;
+    r->date.hour[1] = ihour % 10;
+
+    /* Set minutes */
+    r->date.minute[0] = r->tm.tm_min / 10;
+    r->date.minute[1] = r->tm.tm_min % 10;
+
+    /* Set date string */
+    memcpy(r->date.old_datestr, r->date.datestr, RENDER_DATE_SIZE);
+    if(!strftime(tmpstr, sizeof(tmpstr), r->format, &(r->tm))) {
+        tmpstr[0] = '\0';
+    }
+    snprintf(r->date.datestr, RENDER_DATE_SIZE, "%s%s", tmpstr, r->meridiem);
+
+    /* Set seconds */
+    r->date.second[0] = r->tm.tm_sec / 10;
+    r->date.second[1] = r->tm.tm_sec % 10;
+
+    return;
+}
+
+
+/**
+ * Width of the frame, its height is RENDER_HEIGHT
+ */
+int
+render_width(const render_t *r)
+{
+    return (r->second) ? RENDER_SECW : RENDER_NORMW;
+}
+
+
+/**
+ * Column of a digit in the frame, all of them start on row 1
+ */
+int
+render_digit_x(int slot)
+{
+    return digit_x[slot];
+}
+
+
+/**
+ * Forget what the buffer holds, everything is drawn again. To be called when
+ * the caller cleared what it shows.
+ */
+void
+render_invalidate(render_buf_t *buf)
+{
+    int i;
+
+    for(i = 0; i < buf->w * buf->h; ++i) {
+        buf->cells[i].ch = RENDER_STALE;
+    }
+
+    return;
+}
+
+
+/**
+ * Draw the digits and dots into the frame at (x, y), which has a border of
+ * one cell. Returns the number of rectangles in dirty which changed.
+ */
+int
+render_clock(render_t *r, render_buf_t *buf, int x, int y, uint64_t now,
+             render_rect_t dirty[RENDER_RECTS])
+{
+    render_rect_t rects[RENDER_RECTS];
+    const uint8_t attr = (r->bold) ? RENDER_BLINK : 0;
+    const uint8_t dotcolor = (r->blink && r->lt % 2 == 0) ? RENDER_TEXT : RENDER_BLOCK;
+    const int digits[ANIM_SLOTS] = {
+        r->date.hour[0], r->date.hour[1],
+        r->date.minute[0], r->date.minute[1],
+        r->date.second[0], r->date.second[1],
+    };
+    const int slots = (r->second) ? ANIM_SLOTS : ANIM_SLOTS - 2;
+    int i;
+
+    memset(rects, 0, sizeof(rects));
+
+    for(i = 0; i < slots; ++i) {
+        put_digit(r, buf, i, digits[i], x + digit_x[i], y + 1, now, &rects[i]);
+    }
+
+    put_colon(buf, x + 16, y + 1, dotcolor, attr, &rects[ANIM_SLOTS]);
+    if(r->second) {
+        put_colon(buf, x + RENDER_NORMW, y + 1, dotcolor, attr, &rects[ANIM_SLOTS + 1]);
+    }
+
+    return collect(rects, RENDER_RECTS, dirty);
+}
+
+
+/**
+ * Draw the date on row y from column x, the rest of the row is blanked
+ */
+int
+render_date(const render_t *r, render_buf_t *buf, int x, int y,
+            render_rect_t dirty[RENDER_RECTS])
+{
+    const uint8_t attr = (r->bold) ? RENDER_BOLD : 0;
+    const char *p = r->date.datestr;
+    size_t left = strlen(p), len;
+    render_rect_t rect = {0, 0, 0, 0};
+    mbstate_t ps;
+    wchar_t wc;
+
+    memset(&ps, 0, sizeof(ps));
+    while(left && x < buf->w) {
+        len = mbrtowc(&wc, p, left, &ps);
+        if(len == (size_t)-1 || len == (size_t)-2 || !len) {
+            memset(&ps, 0, sizeof(ps));
+            wc = '?';
+            len = 1;
+        }
+        put(buf, x++, y, (uint32_t)wc, RENDER_TEXT, attr, &rect);
+        if(wcwidth(wc) == 2) {
+            put(buf, x++, y, 0, RENDER_TEXT, attr, &rect);
+        }
+        p += len;
+        left -= len;
+    }
+    while(x < buf->w) {
+        put(buf, x++, y, ' ', RENDER_BLANK, 0, &rect);
+    }
+
+    return collect(&rect, 1, dirty);
+}
+
+
+bool
+render_active(const render_t *r)
+{
+    return anim_active(&r->anim);
+}
+
+
+/**
+ * Shorten the wait to the next frame of a digit transition
+ */
+bool
+render_timeout(const render_t *r, uint64_t now, struct timespec *length)
+{
+    return anim_timeout(&r->anim, now, length);
+}
+
+
+/**
+ * Account for the cost of the last frame, see anim_cost()
+ */
+void
+render_cost(render_t *r, uint64_t ns, size_t bytes)
+{
+    anim_cost(&r->anim, ns, bytes);
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,133 @@
+/*
+ *     TTY-CLOCK render.h file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#ifndef RENDER_H
+#define RENDER_H
+
+/*
+ * The clock face without ncurses: time, glyphs and layout, drawn into a
+ * buffer of cells owned by the caller. x is the column and y the row.
+ * Nothing is allocated, so several clocks can be drawn from one process.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "anim.h"
+
+#define RENDER_NORMW       35  /* hh:mm */
+#define RENDER_SECW        54  /* hh:mm:ss */
+#define RENDER_HEIGHT      7
+#define RENDER_DATE_SIZE   256
+#define RENDER_RECTS       (ANIM_SLOTS + 2)
+#define RENDER_AMSIGN      " [AM]"
+#define RENDER_PMSIGN      " [PM]"
+
+/* Colors of a cell, the blocks are spaces on the clock color */
+#define RENDER_BLANK       0
+#define RENDER_BLOCK       1
+#define RENDER_TEXT        2
+
+/* Attributes of a cell */
+#define RENDER_BOLD        0x1
+#define RENDER_BLINK       0x2
+
+/* Never drawn, marks cells which have to be drawn again */
+#define RENDER_STALE       0xffffffffu
+
+typedef struct {
+    uint32_t ch;   /* code point, 0 for the right half of a wide one */
+    uint8_t color;
+    uint8_t attr;
+    uint16_t pad;
+} render_cell_t;
+
+typedef struct {
+    int x, y, w, h;
+} render_rect_t;
+
+typedef struct {
+    render_cell_t *cells; /* w * h, row by row */
+    int w, h;
+} render_buf_t;
+
+typedef struct {
+    /* Options, set by the caller */
+    bool second;
+    bool twelve;
+    bool utc;
+    bool blink;
+    bool bold;
+    bool sprites; /* digits are drawn by the caller, their cells stay blank */
+    char pad_opt[2];
+    int effect;
+    const char *format;
+
+    /* Time of the last render_time() */
+    time_t lt;
+    struct tm tm;
+    const char *meridiem;
+
+    /* Date content ([2] = number by number) */
+    struct {
+        int hour[2];
+        int minute[2];
+        int second[2];
+        char datestr[RENDER_DATE_SIZE];
+        char old_datestr[RENDER_DATE_SIZE];
+    } date;
+
+    /* Rows of each digit as last drawn, transitions included */
+    uint8_t rows[ANIM_SLOTS][ANIM_ROWS];
+
+    anim_t anim;
+} render_t;
+
+void render_init(render_t *r);
+void render_time(render_t *r, time_t lt);
+int render_width(const render_t *r);
+int render_digit_x(int slot);
+void render_invalidate(render_buf_t *buf);
+int render_clock(render_t *r, render_buf_t *buf, int x, int y, uint64_t now,
+                 render_rect_t dirty[RENDER_RECTS]);
+int render_date(const render_t *r, render_buf_t *buf, int x, int y,
+                render_rect_t dirty[RENDER_RECTS]);
+bool render_active(const render_t *r);
+bool render_timeout(const render_t *r, uint64_t now, struct timespec *length);
+void render_cost(render_t *r, uint64_t ns, size_t bytes);
+
+#endif /* RENDER_H */
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
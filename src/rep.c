@@ -0,0 +1,128 @@
+/*
+ *     TTY-CLOCK rep.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "rep.h"
+
+
+/**
+ * Send runs of the same character as the character and REP, in place as the
+ * frame only gets shorter. Escape sequences and strings (sixel images) are
+ * copied as they are, so is text in another character set, as terminals
+ * don't agree on what REP repeats there. rep carries the character sets
+ * from a frame to the next.
+ */
+size_t
+rep_encode(rep_t *rep, char *buf, size_t len)
+{
+    enum { TEXT, ESC, CSI, STRING, STRING_ESC, CHARSET, INTERMEDIATE } state = TEXT;
+    char seq[16];
+    size_t in = 0, out = 0, run;
+    int n;
+    char c;
+
+    while(in < len) {
+        c = buf[in];
+
+        switch(state) {
+        case TEXT:
+            if(c == '\033') {
+                state = ESC;
+            } else if(c == '\016' || c == '\017') {
+                rep->shift = (c == '\016');
+            } else if(c >= ' ' && c <= '~' && !rep->acs && !rep->shift) {
+                for(run = 1; in + run < len && buf[in + run] == c; ++run);
+                if(run >= REP_MIN
+                   && (n = snprintf(seq, sizeof(seq), "\033[%zub", run - 1)) > 0
+                   && (size_t)n + 1 < run) {
+                    buf[out++] = c;
+                    memcpy(buf + out, seq, (size_t)n);
+                    out += (size_t)n;
+                    in += run;
+                    continue;
+                }
+                memmove(buf + out, buf + in, run);
+                out += run;
+                in += run;
+                continue;
+            }
+            break;
+        case ESC:
+            if(c == '[') {
+                state = CSI;
+            } else if(c == 'P' || c == ']' || c == '_' || c == '^' || c == 'X') {
+                state = STRING;
+            } else if(c == '(') {
+                state = CHARSET;
+            } else if(c >= ' ' && c <= '/') {
+                state = INTERMEDIATE;
+            } else {
+                state = TEXT;
+            }
+            break;
+        case CSI:
+            if(c >= '@' && c <= '~') {
+                state = TEXT;
+            }
+            break;
+        case STRING:
+            if(c == '\007') {
+                state = TEXT;
+            } else if(c == '\033') {
+                state = STRING_ESC;
+            }
+            break;
+        case STRING_ESC:
+            state = (c == '\\') ? TEXT : STRING;
+            break;
+        case CHARSET:
+            rep->acs = (c != 'B');
+            state = TEXT;
+            break;
+        case INTERMEDIATE:
+            if(c >= '0' && c <= '~') {
+                state = TEXT;
+            }
+            break;
+        }
+        buf[out++] = buf[in++];
+    }
+
+    return out;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
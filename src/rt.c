@@ -0,0 +1,140 @@
+/*
+ *     TTY-CLOCK rt.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include "rt.h"
+
+static struct {
+    int got; /* RT_* */
+    int cpu;
+} rt = { 0, -1 };
+
+
+/* Prototypes */
+static void prefault(void);
+
+
+/**
+ * Touch the stack the loop will use, so that mlockall() keeps it resident
+ */
+static void
+prefault(void)
+{
+    volatile char stack[RT_PREFAULT];
+    const long page = sysconf(_SC_PAGESIZE);
+    size_t i;
+
+    for(i = 0; i < sizeof(stack); i += (page > 0) ? (size_t)page : 4096) {
+        stack[i] = 0;
+    }
+
+    return;
+}
+
+
+/**
+ * Make the calling thread, and the threads it starts afterwards, realtime:
+ * SCHED_FIFO (or a negative nice value if not permitted), the memory locked
+ * and, if cpu >= 0, pinned to that cpu. Returns the RT_* which succeeded.
+ */
+int
+rt_start(int cpu)
+{
+    struct sched_param param;
+
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = RT_PRIORITY;
+    if(sched_setscheduler(0, SCHED_FIFO, &param) == 0) {
+        rt.got |= RT_FIFO;
+    } else if(setpriority(PRIO_PROCESS, 0, RT_NICENESS) == 0) {
+        rt.got |= RT_NICE;
+    }
+#ifdef __linux__
+    /* Time-shared threads get their timers coalesced, 50us by default */
+    if(!(rt.got & RT_FIFO)) {
+        prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+    }
+#endif
+
+    /*
+     * Only what is mapped now: the loop doesn't allocate, and locking the
+     * future mappings too would lock the whole stack of every thread
+     */
+    prefault();
+    if(mlockall(MCL_CURRENT) == 0) {
+        rt.got |= RT_LOCKED;
+    }
+
+#ifdef __linux__
+    if(cpu >= 0 && cpu < CPU_SETSIZE) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if(sched_setaffinity(0, sizeof(set), &set) == 0) {
+            rt.got |= RT_PINNED;
+            rt.cpu = cpu;
+        }
+    }
+#else
+    (void)cpu;
+#endif
+
+    return rt.got;
+}
+
+
+void
+rt_report(FILE *file)
+{
+    fprintf(file, "realtime: %s",
+            (rt.got & RT_FIFO) ? "SCHED_FIFO" : (rt.got & RT_NICE) ? "nice" : "time-shared");
+    fprintf(file, ", memory %slocked", (rt.got & RT_LOCKED) ? "" : "not ");
+    if(rt.got & RT_PINNED) {
+        fprintf(file, ", cpu %d", rt.cpu);
+    }
+    fprintf(file, "\n");
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
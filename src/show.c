@@ -60,7 +60,7 @@ show_version(void)
 void
 show_help(void)
 {
-    printf("usage : tty-clock [-iuvsScbtrahDBxn] [-C [0-7]] [-f format] [-d delay] [-a nsdelay] [-T tty] \n"
+    printf("usage : tty-clock [-iuvsScbtrahDBxnAGkHQ] [-C [0-7]] [-f format] [-d delay] [-a nsdelay] [-T tty] [-F file] [-P trace] [-L alarms] [-R file] [-e effect] [-p interval] [-K cpu] \n"
           "    -s          Show seconds                            \n"
           "    -S          Screensaver mode                         \n"
           "    -x          Show box                                \n"
@@ -78,6 +78,18 @@ show_help(void)
           "    -h          Show this page                           \n"
           "    -D          Hide date                               \n"
           "    -B          Enable blinking colon                     \n"
+          "    -A          Show an analog clock face                 \n"
+          "    -G          Draw the digits as sixel images if possible  \n"
+          "    -F file     Read (and watch) the given config file     \n"
+          "    -P trace    Write a Chrome trace on exit or SIGUSR1    \n"
+          "    -L alarms   Flash or change color at the given times   \n"
+          "    -R file     Record the terminal output to file         \n"
+          "    -e effect   Digit transition: none, slide, dissolve, flip \n"
+          "    -p interval Show load, memory, uptime and cpu every interval seconds \n"
+          "    -k          Realtime mode, reports the wake latency on exit \n"
+          "    -K cpu      Realtime mode pinned to the given cpu          \n"
+          "    -H          Pause on focus loss (focus reports, mode 1004)  \n"
+          "    -Q          Try REP even if terminfo doesn't list it     \n"
           "    -d delay    Set the delay between two redraws of the clock. Default 1s. \n"
           "    -a nsdelay  Additional delay between two redraws in nanoseconds. Default 0ns.\n");
 
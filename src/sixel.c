@@ -0,0 +1,290 @@
+/*
+ *     TTY-CLOCK sixel.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "anim.h"
+#include "render.h"
+#include "sixel.h"
+
+/* A growing string which stops at its size */
+typedef struct {
+    char *buf;
+    size_t size, len;
+    bool full;
+} sink_t;
+
+/* Colors 0-7 in percent, as sixel wants them */
+static const uint8_t palette[8][3] = {
+    {  0,   0,   0}, { 80,   0,   0}, {  0,  80,   0}, { 80,  80,   0},
+    {  0,   0,  80}, { 80,   0,  80}, {  0,  80,  80}, { 75,  75,  75},
+};
+
+/* Prototypes */
+static void emit(sink_t *s, const char *fmt, ...);
+static void run(sink_t *s, int value, int count);
+static size_t encode(char *out, size_t size, const uint8_t *rows, int cellw,
+                     int cellh, int color, bool bright);
+static void put_slot(sixel_t *six, sink_t *s, const render_t *r, int slot,
+                     int y, int x, int cellw, int cellh, int color, bool bright);
+
+
+static void
+emit(sink_t *s, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    if(s->full) {
+        return;
+    }
+
+    va_start(ap, fmt);
+    n = vsnprintf(s->buf + s->len, s->size - s->len, fmt, ap);
+    va_end(ap);
+
+    if(n < 0 || (size_t)n >= s->size - s->len) {
+        s->full = true;
+        return;
+    }
+    s->len += (size_t)n;
+
+    return;
+}
+
+
+/**
+ * count columns of the same sixel, repeated with ! from 4 on
+ */
+static void
+run(sink_t *s, int value, int count)
+{
+    const char c = (char)('?' + value);
+
+    if(count > 3) {
+        emit(s, "!%d%c", count, c);
+    } else {
+        while(count-- > 0) {
+            emit(s, "%c", c);
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * A glyph as a sixel image, each pixel the size of two cells wide and one
+ * high. Only the set pixels are painted, the rest stays transparent.
+ */
+static size_t
+encode(char *out, size_t size, const uint8_t *rows, int cellw, int cellh,
+       int color, bool bright)
+{
+    const int w = ANIM_COLS * 2 * cellw, h = ANIM_ROWS * cellh;
+    const uint8_t *rgb = palette[color & 7];
+    sink_t s = { out, size, 0, false };
+    int top, pc, k, value, prev, count;
+
+    emit(&s, "\033P9;1q\"1;1;%d;%d#1;2;%d;%d;%d", w, h,
+         (bright) ? (rgb[0] ? 100 : 50) : rgb[0],
+         (bright) ? (rgb[1] ? 100 : 50) : rgb[1],
+         (bright) ? (rgb[2] ? 100 : 50) : rgb[2]);
+
+    /* Bands of 6 pixel rows, a glyph pixel column is 2 * cellw sixels */
+    for(top = 0; top < h; top += 6) {
+        emit(&s, (top) ? "-#1" : "#1");
+        prev = -1;
+        count = 0;
+        for(pc = 0; pc < ANIM_COLS; ++pc) {
+            value = 0;
+            for(k = 0; k < 6 && top + k < h; ++k) {
+                if((rows[(top + k) / cellh] >> (2 - pc)) & 1) {
+                    value |= 1 << k;
+                }
+            }
+            if(value != prev) {
+                run(&s, prev, count);
+                prev = value;
+                count = 0;
+            }
+            count += 2 * cellw;
+        }
+        /* Blank columns at the end of a band needn't be sent */
+        if(prev) {
+            run(&s, prev, count);
+        }
+    }
+    emit(&s, "\033\\");
+
+    return (s.full) ? 0 : s.len;
+}
+
+
+/**
+ * Clear the cells of a slot and draw its digit. The image is taken from the
+ * cache if the slot shows a plain digit, transition frames are encoded as
+ * they come.
+ */
+static void
+put_slot(sixel_t *six, sink_t *s, const render_t *r, int slot, int y, int x,
+         int cellw, int cellh, int color, bool bright)
+{
+    const uint8_t *rows = r->rows[slot];
+    uint8_t glyph[ANIM_ROWS];
+    const int n = (slot < 2) ? r->date.hour[slot]
+                  : (slot < 4) ? r->date.minute[slot - 2]
+                  : r->date.second[slot - 4];
+    size_t len;
+    int i;
+
+    for(i = 0; i < ANIM_ROWS; ++i) {
+        emit(s, "\033[%d;%dH\033[%dX", y + i + 1, x + 1, ANIM_COLS * 2);
+    }
+    if(color < 0) {
+        return;
+    }
+    emit(s, "\033[%d;%dH", y + 1, x + 1);
+
+    anim_rows(n, glyph);
+    if(memcmp(glyph, rows, ANIM_ROWS)) {
+        if(!s->full && (len = encode(s->buf + s->len, s->size - s->len, rows,
+                                     cellw, cellh, color, bright))) {
+            s->len += len;
+        }
+        return;
+    }
+
+    if(!six->sprite[n].len) {
+        six->sprite[n].len = encode(six->sprite[n].data, SIXEL_SPRITE_SIZE,
+                                    glyph, cellw, cellh, color, bright);
+    }
+    emit(s, "%.*s", (int)six->sprite[n].len, six->sprite[n].data);
+
+    return;
+}
+
+
+/**
+ * Nothing is encoded nor on the screen yet
+ */
+void
+sixel_init(sixel_t *six)
+{
+    memset(six, 0, sizeof(sixel_t));
+    six->color = -2;
+
+    return;
+}
+
+
+/**
+ * Everything on the screen has to be drawn again
+ */
+void
+sixel_invalidate(sixel_t *six)
+{
+    int i;
+
+    for(i = 0; i < ANIM_SLOTS; ++i) {
+        six->slot[i].shown = false;
+    }
+
+    return;
+}
+
+
+/**
+ * The bytes which bring the digits of the frame at row y, column x of the
+ * terminal up to date, NULL if none changed. color is -1 to hide them. The
+ * cursor and attributes are saved around them, so that ncurses doesn't
+ * notice.
+ */
+const char *
+sixel_frame(sixel_t *six, const render_t *r, int y, int x, int cellw, int cellh,
+            int color, bool bright, size_t *len)
+{
+    const int slots = (r->second) ? ANIM_SLOTS : ANIM_SLOTS - 2;
+    sink_t s = { six->frame, SIXEL_FRAME_SIZE, 0, false };
+    int i, sx;
+
+    /* New size or color, encode the digits again as they are needed */
+    if(cellw != six->cellw || cellh != six->cellh
+       || color != six->color || bright != six->bright) {
+        for(i = 0; i < 10; ++i) {
+            six->sprite[i].len = 0;
+        }
+        six->cellw = cellw;
+        six->cellh = cellh;
+        six->color = color;
+        six->bright = bright;
+        sixel_invalidate(six);
+    }
+
+    emit(&s, "\0337\033[m");
+    for(i = 0; i < slots; ++i) {
+        sx = x + render_digit_x(i);
+        if(six->slot[i].shown && six->slot[i].y == y + 1 && six->slot[i].x == sx
+           && six->slot[i].color == color
+           && !memcmp(six->slot[i].rows, r->rows[i], ANIM_ROWS)) {
+            continue;
+        }
+        put_slot(six, &s, r, i, y + 1, sx, cellw, cellh, color, bright);
+
+        memcpy(six->slot[i].rows, r->rows[i], ANIM_ROWS);
+        six->slot[i].y = y + 1;
+        six->slot[i].x = sx;
+        six->slot[i].color = color;
+        six->slot[i].shown = true;
+    }
+    emit(&s, "\0338");
+
+    if(s.full) {
+        sixel_invalidate(six);
+    }
+    if(s.full || s.len == sizeof("\0337\033[m\0338") - 1) {
+        *len = 0;
+        return NULL;
+    }
+    *len = s.len;
+
+    return six->frame;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,79 @@
+/*
+ *     TTY-CLOCK sixel.h file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#ifndef SIXEL_H
+#define SIXEL_H
+
+/*
+ * Digits drawn as sixel images over the blank cells of the clock
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "anim.h"
+#include "render.h"
+
+#define SIXEL_SPRITE_SIZE 4096
+#define SIXEL_FRAME_SIZE  (ANIM_SLOTS * (SIXEL_SPRITE_SIZE + 128) + 16)
+
+/*
+ * The digits encoded once for the current cell size and color, what is on
+ * the screen in each slot and the last frame, owned by the caller
+ */
+typedef struct {
+    int cellw, cellh, color;
+    bool bright;
+    char pad[3]; /* alignment */
+    struct {
+        char data[SIXEL_SPRITE_SIZE];
+        size_t len;
+    } sprite[10];
+    struct {
+        uint8_t rows[ANIM_ROWS];
+        int y, x, color;
+        bool shown;
+    } slot[ANIM_SLOTS];
+    char frame[SIXEL_FRAME_SIZE];
+} sixel_t;
+
+void sixel_init(sixel_t *six);
+void sixel_invalidate(sixel_t *six);
+const char *sixel_frame(sixel_t *six, const render_t *r, int y, int x, int cellw,
+                        int cellh, int color, bool bright, size_t *len);
+
+#endif /* SIXEL_H */
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,204 @@
+/*
+ *     TTY-CLOCK stats.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "stats.h"
+
+bool stats_enabled;
+
+/* A latency distribution, bucket i counts the samples under 2^i us */
+typedef struct {
+    uint64_t count;
+    uint64_t sum, min, max; /* ns */
+    uint64_t hist[STATS_BUCKETS];
+} latency_t;
+
+/*
+ * Lateness of the timed wakes, against the deadline they were asked for,
+ * the time frames took from being queued to being written, the frames the
+ * terminal was too slow to take and the wall clock steps. write is only
+ * touched by the writer thread, and read once it stopped.
+ */
+static struct {
+    uint64_t dropped;
+    uint64_t jumps;
+    int64_t largest; /* ns, the step furthest from 0 */
+    latency_t wake;
+    latency_t write;
+} stats;
+
+
+/* Prototypes */
+static void account(latency_t *l, uint64_t ns);
+static unsigned long long percentile(const latency_t *l, unsigned int p);
+static void report(FILE *file, const char *what, const char *unit, const latency_t *l);
+
+
+static void
+account(latency_t *l, uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    int i = 0;
+
+    while(us && i < STATS_BUCKETS - 1) {
+        us >>= 1;
+        ++i;
+    }
+    ++l->hist[i];
+
+    if(!l->count || ns < l->min) {
+        l->min = ns;
+    }
+    if(ns > l->max) {
+        l->max = ns;
+    }
+    l->sum += ns;
+    ++l->count;
+
+    return;
+}
+
+
+/**
+ * Upper bound in us of the bucket holding p percent of the samples
+ */
+static unsigned long long
+percentile(const latency_t *l, unsigned int p)
+{
+    const uint64_t want = (l->count * p + 99) / 100;
+    uint64_t seen = 0;
+    int i;
+
+    for(i = 0; i < STATS_BUCKETS - 1; ++i) {
+        if((seen += l->hist[i]) >= want) {
+            break;
+        }
+    }
+
+    return 1ull << i;
+}
+
+
+static void
+report(FILE *file, const char *what, const char *unit, const latency_t *l)
+{
+    if(!l->count) {
+        return;
+    }
+    fprintf(file, "%s over %llu %s: min %.1fus, avg %.1fus, p50 <%lluus, p99 <%lluus, "
+            "max %.1fus\n", what, (unsigned long long)l->count, unit, (double)l->min / 1000, (double)l->sum / (double)l->count / 1000,
+            percentile(l, 50), percentile(l, 99), (double)l->max / 1000);
+
+    return;
+}
+
+
+/**
+ * Account one wake which came late ns after its deadline
+ */
+void
+stats_wake(uint64_t late)
+{
+    if(stats_enabled) {
+        account(&stats.wake, late);
+    }
+
+    return;
+}
+
+
+/**
+ * Account one frame which took ns from being queued to being written, from
+ * the writer thread
+ */
+void
+stats_write(uint64_t ns)
+{
+    if(stats_enabled) {
+        account(&stats.write, ns);
+    }
+
+    return;
+}
+
+
+/**
+ * Account one frame which was dropped instead of waiting for the terminal
+ */
+void
+stats_drop(void)
+{
+    ++stats.dropped;
+
+    return;
+}
+
+
+/**
+ * Account one step of the wall clock, jump ns forward or back
+ */
+void
+stats_jump(int64_t jump)
+{
+    if((jump < 0 ? -jump : jump) > (stats.largest < 0 ? -stats.largest : stats.largest)) {
+        stats.largest = jump;
+    }
+    ++stats.jumps;
+
+    return;
+}
+
+
+/**
+ * Write the dropped frames if there were any, and the latencies once enabled
+ */
+void
+stats_report(FILE *file)
+{
+    if(stats.dropped || stats_enabled) {
+        fprintf(file, "%llu frames dropped\n", (unsigned long long)stats.dropped);
+    }
+    if(!stats_enabled) {
+        return;
+    }
+    if(stats.jumps) {
+        fprintf(file, "%llu wall clock steps, the largest by %+.3fs\n",
+                (unsigned long long)stats.jumps, (double)stats.largest / 1e9);
+    }
+    report(file, "wake latency", "wakes", &stats.wake);
+    report(file, "write latency", "frames", &stats.write);
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
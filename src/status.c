@@ -0,0 +1,213 @@
+/*
+ *     TTY-CLOCK status.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "status.h"
+
+/* The files stay open, every sample is one pread() each */
+#define STATUS_LOADAVG 0
+#define STATUS_MEMINFO 1
+#define STATUS_UPTIME  2
+#define STATUS_STAT    3
+#define STATUS_FILES   4
+
+static const char *const path[STATUS_FILES] = {
+    "/proc/loadavg", "/proc/meminfo", "/proc/uptime", "/proc/stat",
+};
+
+static int fd[STATUS_FILES] = { -1, -1, -1, -1 };
+
+
+/* Prototypes */
+static bool read_file(int file, char *buf);
+static unsigned long field(const char *buf, const char *key);
+
+
+/**
+ * The start of a file, NUL terminated
+ */
+static bool
+read_file(int file, char *buf)
+{
+    ssize_t n = pread(fd[file], buf, STATUS_READ - 1, 0);
+
+    if(n <= 0) {
+        return false;
+    }
+    buf[n] = '\0';
+
+    return true;
+}
+
+
+/**
+ * Value of a 'Key:   value kB' line of /proc/meminfo
+ */
+static unsigned long
+field(const char *buf, const char *key)
+{
+    const char *p = strstr(buf, key);
+
+    return (p) ? strtoul(p + strlen(key), NULL, 10) : 0;
+}
+
+
+bool
+status_open(void)
+{
+    int i;
+
+    for(i = 0; i < STATUS_FILES; ++i) {
+        if((fd[i] = open(path[i], O_RDONLY | O_CLOEXEC)) == -1) {
+            status_close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Read and parse the files, the cpu usage is relative to the last call
+ */
+bool
+status_sample(status_t *st)
+{
+    char buf[STATUS_READ];
+    unsigned long long v[8] = {0}, busy, total;
+    char *p, *end;
+    int i;
+
+    if(!read_file(STATUS_LOADAVG, buf)) {
+        return false;
+    }
+    p = buf;
+    for(i = 0; i < 3; ++i) {
+        st->load[i] = strtod(p, &p);
+    }
+
+    if(!read_file(STATUS_MEMINFO, buf)) {
+        return false;
+    }
+    st->memtotal = field(buf, "MemTotal:");
+    st->memavail = field(buf, "MemAvailable:");
+
+    if(!read_file(STATUS_UPTIME, buf)) {
+        return false;
+    }
+    st->uptime = strtoul(buf, NULL, 10);
+
+    /* cpu  user nice system idle iowait irq softirq steal */
+    if(!read_file(STATUS_STAT, buf) || strncmp(buf, "cpu ", 4)) {
+        return false;
+    }
+    p = buf + 4;
+    for(i = 0; i < 8; ++i, p = end) {
+        v[i] = strtoull(p, &end, 10);
+        if(end == p) {
+            break;
+        }
+    }
+    total = v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6] + v[7];
+    busy = total - v[3] - v[4];
+    if(st->total && total > st->total) {
+        st->cpu = (int)((busy - st->busy) * 100 / (total - st->total));
+    }
+    st->busy = busy;
+    st->total = total;
+
+    return true;
+}
+
+
+/**
+ * One line of the panel, always STATUS_WIDTH wide so that the window keeps
+ * its size
+ */
+void
+status_line(const status_t *st, int line, char *buf, size_t size)
+{
+    const unsigned long used = (st->memtotal > st->memavail)
+                               ? st->memtotal - st->memavail : 0;
+    size_t n;
+
+    switch(line) {
+    case 0:
+        snprintf(buf, size, "load %5.2f %5.2f %5.2f", st->load[0], st->load[1], st->load[2]);
+        break;
+    case 1:
+        snprintf(buf, size, "mem  %3lu%% of %6.1f GiB",
+                 (st->memtotal) ? used * 100 / st->memtotal : 0,
+                 (double)st->memtotal / (1024 * 1024));
+        break;
+    case 2:
+        snprintf(buf, size, "up   %4lud %02lu:%02lu", st->uptime / 86400,
+                 st->uptime / 3600 % 24, st->uptime / 60 % 60);
+        break;
+    default:
+        snprintf(buf, size, "cpu  %3d%%", st->cpu);
+        break;
+    }
+
+    /* Pad with blanks, the old line is overwritten without clearing */
+    for(n = strlen(buf); n < STATUS_WIDTH && n + 1 < size; ++n) {
+        buf[n] = ' ';
+    }
+    buf[n] = '\0';
+
+    return;
+}
+
+
+void
+status_close(void)
+{
+    int i;
+
+    for(i = 0; i < STATUS_FILES; ++i) {
+        if(fd[i] >= 0) {
+            close(fd[i]);
+        }
+        fd[i] = -1;
+    }
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
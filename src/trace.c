@@ -0,0 +1,198 @@
+/*
+ *     TTY-CLOCK trace.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include "trace.h"
+
+/* One finished span */
+typedef struct {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+    long tid;
+} trace_event_t;
+
+bool trace_enabled;
+
+/* Trace ring */
+static struct {
+    char *path;
+    trace_event_t *event;
+    uint64_t count; /* total number of events, the ring keeps the last ones */
+} trace;
+
+/* Thread of the spans, so that the writer thread gets a track of its own */
+static __thread long tid;
+
+
+/* Prototypes */
+static long thread_id(void);
+
+
+/**
+ * Allocate the ring and enable tracing, the ring is written to path by
+ * trace_dump()
+ */
+bool
+trace_init(const char *path)
+{
+    trace_free();
+
+    trace.path = strdup(path);
+    trace.event = calloc(TRACE_EVENTS, sizeof(trace_event_t));
+    if(!trace.path || !trace.event) {
+        trace_free();
+
+        return false;
+    }
+    trace_enabled = true;
+
+    return true;
+}
+
+
+static long
+thread_id(void)
+{
+    if(!tid) {
+#ifdef __linux__
+        tid = (long)syscall(SYS_gettid);
+#else
+        tid = (long)getpid();
+#endif
+    }
+
+    return tid;
+}
+
+
+/**
+ * Monotonic time in nanoseconds
+ */
+uint64_t
+trace_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+
+/**
+ * Close a span opened with trace_begin(), the name must be a static string.
+ * Safe to call from any thread.
+ */
+void
+trace_end(const char *name, uint64_t start)
+{
+    trace_event_t *ev;
+
+    if(!start) {
+        return;
+    }
+
+    ev = &trace.event[__atomic_fetch_add(&trace.count, 1, __ATOMIC_RELAXED) & (TRACE_EVENTS - 1)];
+    ev->name = name;
+    ev->start = start;
+    ev->end = trace_clock();
+    ev->tid = thread_id();
+
+    return;
+}
+
+
+/**
+ * Write the ring as Chrome/Perfetto trace JSON, oldest event first
+ */
+bool
+trace_dump(void)
+{
+    const trace_event_t *ev;
+    const long pid = (long)getpid();
+    const uint64_t count = __atomic_load_n(&trace.count, __ATOMIC_RELAXED);
+    uint64_t i = 0;
+    FILE *file;
+
+    if(!trace_enabled) {
+        return true;
+    }
+    if(!(file = fopen(trace.path, "w"))) {
+        return false;
+    }
+
+    if(count > TRACE_EVENTS) {
+        i = count - TRACE_EVENTS;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    for(; i < count; ++i) {
+        ev = &trace.event[i & (TRACE_EVENTS - 1)];
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%ld,\"tid\":%ld,"
+                "\"ts\":%llu.%03u,\"dur\":%llu.%03u}%s\n",
+                ev->name, pid, ev->tid,
+                (unsigned long long)(ev->start / 1000), (unsigned)(ev->start % 1000),
+                (unsigned long long)((ev->end - ev->start) / 1000),
+                (unsigned)((ev->end - ev->start) % 1000),
+                (i + 1 < count) ? "," : "");
+    }
+    fputs("]}\n", file);
+
+    return (fclose(file) == 0);
+}
+
+
+/**
+ * Disable tracing and free the ring
+ */
+void
+trace_free(void)
+{
+    trace_enabled = false;
+    free(trace.path);
+    free(trace.event);
+    memset(&trace, 0, sizeof(trace));
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
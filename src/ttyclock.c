@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <getopt.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -43,29 +44,39 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <locale.h>
+#include <termios.h>
 #include <time.h>
 #include <unistd.h>
+#include <wchar.h>
 #include <ncurses.h>
+#include "alarm.h"
+#include "analog.h"
+#include "anim.h"
+#include "config.h"
+#include "input.h"
+#include "output.h"
+#include "record.h"
+#include "render.h"
+#include "rt.h"
 #include "show.h"
+#include "sixel.h"
+#include "stats.h"
+#include "status.h"
+#include "trace.h"
 #include "ttyclock.h"
+#include "tz.h"
+#include "wallclock.h"
 
 /* Global variable */
 static ttyclock_t ttyclock;
 static option_t option;
 
-/* Number matrix */
-static const bool number[][15] = {
-    {1,1,1,1,0,1,1,0,1,1,0,1,1,1,1}, /* 0 */
-    {0,0,1,0,0,1,0,0,1,0,0,1,0,0,1}, /* 1 */
-    {1,1,1,0,0,1,1,1,1,1,0,0,1,1,1}, /* 2 */
-    {1,1,1,0,0,1,1,1,1,0,0,1,1,1,1}, /* 3 */
-    {1,0,1,1,0,1,1,1,1,0,0,1,0,0,1}, /* 4 */
-    {1,1,1,1,0,0,1,1,1,0,0,1,1,1,1}, /* 5 */
-    {1,1,1,1,0,0,1,1,1,1,0,1,1,1,1}, /* 6 */
-    {1,1,1,0,0,1,0,0,1,0,0,1,0,0,1}, /* 7 */
-    {1,1,1,1,0,1,1,1,1,1,0,1,1,1,1}, /* 8 */
-    {1,1,1,1,0,1,1,1,1,0,0,1,1,1,1}, /* 9 */
-};
+/* Cells of the frame and date windows */
+static render_cell_t framecells[RENDER_HEIGHT * RENDER_SECW];
+static render_cell_t datecells[RENDER_DATE_SIZE];
+
+/* Sixel digits, encoded and on the screen */
+static sixel_t sixel;
 
 
 /* Prototypes */
@@ -74,23 +85,49 @@ static void init_object(void);
 static bool init_screen(void);
 static void init_signal(void);
 static bool init_option(int argc, char **argv);
+static bool set_option(option_t *opt, int c, const char *arg);
+static void cmdline_option(option_t *opt);
 static void signal_handler(int signal);
 static void clean_screen(void);
+static void resize_screen(void);
+static void flush_frame(void);
+static void draw_sprites(void);
 static void update_hour(void);
-static void draw_number(int n, int x, int y);
+static void update_alarm(void);
+static void set_fg(short fg);
+static short clock_pair(int color);
+static void alarm_timeout(struct timespec *length);
+static void status_start(void);
+static void status_stop(void);
+static void update_status(void);
+static void draw_status(void);
+static void status_place(void);
+static bool status_timeout(uint64_t now, struct timespec *length);
+static int status_height(void);
+static void draw_cells(WINDOW *win, const render_buf_t *buf, const render_rect_t *rect, int y, int x);
 static void draw_clock(void);
 static void clock_move(int x, int y, int w, int h);
+static void win_resize(WINDOW *win, int h, int w);
 static void clock_rebound(void);
 static void set_second(void);
 static void set_center(bool b);
 static void set_box(bool b);
+static void set_analog(bool b);
+static void reload_config(void);
+static bool wait_event(const struct timespec *length);
+static void key_press(int c);
+static bool key_quit(int c);
+static void update_quit(void);
 static bool key_event(void);
 
 
 int
 main(int argc, char **argv)
 {
+    uint64_t start;
+
     setlocale(LC_TIME,"");
+    setlocale(LC_CTYPE,"");
 
     if (!init_security()) {
         return 1;
@@ -101,15 +138,59 @@ main(int argc, char **argv)
     if (!init_option(argc, argv)) {
         return ttyclock.exit;
     }
+    /* SIGWINCH is ours, so ncurses must not install its own handler */
+    init_signal();
+    ttyclock.tzfd = tz_watch();
+    ttyclock.clockfd = wallclock_watch();
     if (!init_screen()) {
         return EXIT_FAILURE;
     }
-    init_signal();
+    if (ttyclock.config) {
+        ttyclock.configfd = config_watch(ttyclock.config);
+    }
+    /* Before the writer and input threads start, so that they inherit the policy */
+    if (option.realtime) {
+        rt_start(option.cpu);
+    }
+    stats_enabled = option.realtime || trace_enabled;
+    update_quit();
+    if (!output_start()
+        || !input_start((ttyclock.ftty) ? fileno(ttyclock.ftty) : STDIN_FILENO, key_quit)) {
+        ttyclock.exit = EXIT_FAILURE;
+        return EXIT_FAILURE;
+    }
 
     while(ttyclock.running && !ttyclock.exit) {
-        clock_rebound();
-        update_hour();
-        draw_clock();
+        if (ttyclock.dump) {
+            ttyclock.dump = false;
+            trace_dump();
+        }
+        if (ttyclock.resize) {
+            resize_screen();
+        }
+        /* Nothing is drawn while paused, the first frame after catches up */
+        if (!ttyclock.unfocused || !option.pause) {
+            /* Transition frames must not speed up the rebound */
+            if (!ttyclock.tween) {
+                clock_rebound();
+            }
+            update_hour();
+            /* After the time is read, so that an alarm isn't a tick late */
+            update_alarm();
+            update_status();
+            start = trace_clock();
+            draw_clock();
+            flush_frame();
+            if (render_active(&ttyclock.render)) {
+                /* The terminal's share comes from the writer thread */
+                render_cost(&ttyclock.render, trace_clock() - start + output_latency(),
+                            output_bytes());
+            }
+        } else {
+            /* Only the time the alarms go by, the date change is left to that frame */
+            ttyclock.render.lt = time(NULL);
+            update_alarm();
+        }
         if (!key_event()) {
             return ttyclock.exit;
         }
@@ -129,7 +210,30 @@ static bool init_option(int argc, char **argv)
     int c; /* argument option */
     struct stat sbuf; /* for option 'T' */
 
-    while ((c = getopt(argc, argv, "iuvsScbtrhBxnDC:f:d:T:a:")) != -1) {
+    /* Read the config file first, the command line overrides it */
+    ttyclock.argc = argc;
+    ttyclock.argv = argv;
+    opterr = 0;
+    while ((c = getopt(argc, argv, OPTSTRING)) != -1) {
+        if (c == 'F') {
+            free(ttyclock.config);
+            ttyclock.config = strdup(optarg);
+            if (!config_load(ttyclock.config, &option)) {
+                fprintf(stderr, "ERROR: couldn't read '%s': %s.\n",
+                        optarg, strerror(errno));
+
+                ttyclock.exit = EXIT_FAILURE;
+                return false;
+            }
+        }
+    }
+    if (!ttyclock.config && (ttyclock.config = config_path())) {
+        config_load(ttyclock.config, &option);
+    }
+    opterr = 1;
+    optind = 1;
+
+    while ((c = getopt(argc, argv, OPTSTRING)) != -1) {
         switch(c) {
         case 'h':
         default:
@@ -142,59 +246,11 @@ static bool init_option(int argc, char **argv)
             ttyclock.exit = EXIT_SUCCESS;
             return false;
             /* 'break' is unreachable */
-        case 'u':
-            option.utc = true;
-            break;
         case 'v':
             show_version();
             ttyclock.exit = EXIT_SUCCESS;
             return false;
             /* 'break' is unreachable */
-        case 's':
-            option.second = true;
-            break;
-        case 'S':
-            option.screensaver = true;
-            break;
-        case 'c':
-            option.center = true;
-            break;
-        case 'b':
-            option.bold = true;
-            break;
-        case 'C':
-            if(atoi(optarg) >= 0 && atoi(optarg) < 8) {
-                option.color = (short)atoi(optarg);
-            }
-            break;
-        case 't':
-            option.twelve = true;
-            break;
-        case 'r':
-            option.rebound = true;
-            break;
-        case 'f':
-            strncpy(option.format, optarg, FORMAT_SIZE - 1);
-            break;
-        case 'd':
-            if(atol(optarg) >= 0 && atol(optarg) < DELAY_MAX) {
-                option.delay = atol(optarg);
-            }
-            break;
-        case 'D':
-            option.date = false;
-            break;
-        case 'B':
-            option.blink = true;
-            break;
-        case 'a':
-            if(atol(optarg) >= 0 && atol(optarg) < DELAYNS_MAX) {
-                option.nsdelay = atol(optarg);
-            }
-            break;
-        case 'x':
-            option.box = true;
-            break;
         case 'T':
             if (stat(optarg, &sbuf) == -1) {
                 fprintf(stderr, "ERROR: couldn't stat '%s': %s.\n",
@@ -213,16 +269,174 @@ static bool init_option(int argc, char **argv)
                 ttyclock.tty = strdup(optarg);
             }
             break;
-        case 'n':
-            option.noquit = true;
+        case 'F':
+            /* already read */
+            break;
+        case 'L':
+            if (!alarm_load(optarg, time(NULL))) {
+                fprintf(stderr, "ERROR: couldn't read '%s': %s.\n",
+                        optarg, strerror(errno));
+
+                ttyclock.exit = EXIT_FAILURE;
+                return false;
+            }
             break;
+        case 'P':
+            if (!trace_init(optarg)) {
+                fprintf(stderr, "ERROR: couldn't allocate the trace buffer.\n");
+
+                ttyclock.exit = EXIT_FAILURE;
+                return false;
+            }
+            break;
+        case 'e':
+            if (anim_effect(optarg) < 0) {
+                fprintf(stderr, "ERROR: unknown effect '%s', "
+                        "use none, slide, dissolve or flip.\n", optarg);
+
+                ttyclock.exit = EXIT_FAILURE;
+                return false;
+            }
+            set_option(&option, c, optarg);
+            break;
+        case 'k':
+            option.realtime = true;
+            break;
+        case 'Q':
+            option.repquery = true;
+            break;
+        case 'K':
+            if(atoi(optarg) >= 0 && atoi(optarg) < SHRT_MAX) {
+                option.cpu = (short)atoi(optarg);
+                option.realtime = true;
+            }
+            break;
+        case 'u': case 's': case 'S': case 'c': case 'b': case 'C': case 't':
+        case 'r': case 'f': case 'd': case 'D': case 'B': case 'A': case 'G':
+        case 'H': case 'a': case 'x': case 'n': case 'p':
+            set_option(&option, c, optarg);
+            break;
+        case 'R':
+            if (!record_init(optarg)) {
+                fprintf(stderr, "ERROR: couldn't create '%s': %s.\n",
+                        optarg, strerror(errno));
+
+                ttyclock.exit = EXIT_FAILURE;
+                return false;
+            }
+            break;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Apply one of the command line options which the config file can set too,
+ * false if c isn't one of them
+ */
+static bool
+set_option(option_t *opt, int c, const char *arg)
+{
+    switch(c) {
+    case 'u':
+        opt->utc = true;
+        break;
+    case 's':
+        opt->second = true;
+        break;
+    case 'S':
+        opt->screensaver = true;
+        break;
+    case 'c':
+        opt->center = true;
+        break;
+    case 'b':
+        opt->bold = true;
+        break;
+    case 'C':
+        if(atoi(arg) >= 0 && atoi(arg) < 8) {
+            opt->color = (short)atoi(arg);
+        }
+        break;
+    case 't':
+        opt->twelve = true;
+        break;
+    case 'r':
+        opt->rebound = true;
+        break;
+    case 'f':
+        memset(opt->format, 0, FORMAT_SIZE);
+        strncpy(opt->format, arg, FORMAT_SIZE - 1);
+        break;
+    case 'd':
+        if(atol(arg) >= 0 && atol(arg) < DELAY_MAX) {
+            opt->delay = atol(arg);
+        }
+        break;
+    case 'D':
+        opt->date = false;
+        break;
+    case 'B':
+        opt->blink = true;
+        break;
+    case 'A':
+        opt->analog = true;
+        break;
+    case 'G':
+        opt->sixel = true;
+        break;
+    case 'H':
+        opt->pause = true;
+        break;
+    case 'a':
+        if(atol(arg) >= 0 && atol(arg) < DELAYNS_MAX) {
+            opt->nsdelay = atol(arg);
+        }
+        break;
+    case 'x':
+        opt->box = true;
+        break;
+    case 'n':
+        opt->noquit = true;
+        break;
+    case 'p':
+        if(atol(arg) >= 0 && atol(arg) < DELAY_MAX) {
+            opt->status = atol(arg);
         }
+        break;
+    case 'e':
+        if(anim_effect(arg) >= 0) {
+            opt->effect = (short)anim_effect(arg);
+        }
+        break;
+    default:
+        return false;
     }
 
     return true;
 }
 
 
+/**
+ * Apply the command line again over options read from the config file
+ */
+static void
+cmdline_option(option_t *opt)
+{
+    int c;
+
+    opterr = 0;
+    optind = 1;
+    while ((c = getopt(ttyclock.argc, ttyclock.argv, OPTSTRING)) != -1) {
+        set_option(opt, c, optarg);
+    }
+
+    return;
+}
+
+
 /**
  * Restrict os access by doing unveil and pledge
  */
@@ -236,7 +450,7 @@ init_security(void)
         return false;
     }
 
-    if(pledge("stdio rpath tty", NULL) == -1) {
+    if(pledge("stdio rpath wpath cpath tmppath tty", NULL) == -1) {
         fprintf(stderr, "ERROR: unable to pledge\n");
 
         return false;
@@ -255,8 +469,23 @@ static void
 init_object(void)
 {
     memset(&ttyclock, 0, sizeof(ttyclock_t));
+    ttyclock.configfd = -1;
+    ttyclock.tzfd = -1;
+    ttyclock.clockfd = -1;
 
     option.date = true;
+    option.cpu = -1;
+
+    render_init(&ttyclock.render);
+    sixel_init(&sixel);
+    ttyclock.frame.cells = framecells;
+    ttyclock.frame.w = RENDER_SECW;
+    ttyclock.frame.h = RENDER_HEIGHT;
+    ttyclock.datebuf.cells = datecells;
+    ttyclock.datebuf.w = RENDER_DATE_SIZE;
+    ttyclock.datebuf.h = 1;
+    render_invalidate(&ttyclock.frame);
+    render_invalidate(&ttyclock.datebuf);
 
     /* Default date format */
     strncpy(option.format, "%F", FORMAT_SIZE - 1);
@@ -277,6 +506,11 @@ init_object(void)
 static bool
 init_screen(void)
 {
+    FILE *fin = stdin, *fout;
+    struct termios tios;
+    int lines, cols;
+    short i;
+
     if (ttyclock.tty) {
         ttyclock.ftty = fopen(ttyclock.tty, "r+");
         if (!ttyclock.ftty) {
@@ -286,11 +520,39 @@ init_screen(void)
             ttyclock.exit = EXIT_FAILURE;
             return false;
         }
-        ttyclock.ttyscr = newterm(NULL, ttyclock.ftty, ttyclock.ftty);
-        assert(ttyclock.ttyscr != NULL);
-        set_term(ttyclock.ttyscr);
-    } else {
-        initscr();
+        fin = ttyclock.ftty;
+    }
+
+    /* ncurses renders into a buffer, flush_frame() writes one frame at once */
+    fout = output_open((ttyclock.ftty) ? fileno(ttyclock.ftty) : STDOUT_FILENO);
+    if (!fout) {
+        fprintf(stderr, "ERROR: couldn't create the output buffer: %s.\n",
+               strerror(errno));
+
+        ttyclock.exit = EXIT_FAILURE;
+        return false;
+    }
+
+    /* Terminal modes are set here as ncurses doesn't own the terminal */
+    tcgetattr(fileno(fin), &ttyclock.tios);
+    tios = ttyclock.tios;
+    tios.c_lflag &= (tcflag_t)~(ICANON | ECHO);
+    tios.c_cc[VMIN] = 1;
+    tios.c_cc[VTIME] = 0;
+    tcsetattr(fileno(fin), TCSANOW, &tios);
+
+    ttyclock.ttyscr = newterm(NULL, fout, fin);
+    assert(ttyclock.ttyscr != NULL);
+    set_term(ttyclock.ttyscr);
+
+    if (output_size(&lines, &cols)) {
+        resizeterm(lines, cols);
+    }
+    record_start(COLS, LINES);
+    output_query(fileno(fin), option.repquery);
+    /* Only -H needs them, the reports would wake the clock up for nothing */
+    if (option.pause) {
+        output_focus(true);
     }
 
     ttyclock.bg = COLOR_BLACK;
@@ -298,6 +560,8 @@ init_screen(void)
     cbreak();
     noecho();
     keypad(stdscr, true);
+    /* Keys are read by the input thread, doupdate() mustn't poll for them */
+    typeahead(-1);
     start_color();
     curs_set(false);
     clear();
@@ -307,11 +571,19 @@ init_screen(void)
         ttyclock.bg = -1;
     }
 
-    /* Init color pair */
+    /*
+     * A pair for each color the clock can take, changing one later on makes
+     * ncurses allocate. The flash hides the clock with the last two.
+     */
     init_pair(0, ttyclock.bg, ttyclock.bg);
-    init_pair(1, ttyclock.bg, option.color);
-    init_pair(2, option.color, ttyclock.bg);
-    refresh();
+    for(i = 0; i < COLOR_HIDDEN; ++i) {
+        init_pair(PAIR_CLOCK(i), ttyclock.bg, i);
+        init_pair(PAIR_TEXT(i), i, ttyclock.bg);
+    }
+    init_pair(PAIR_CLOCK(COLOR_HIDDEN), ttyclock.bg, ttyclock.bg);
+    init_pair(PAIR_TEXT(COLOR_HIDDEN), ttyclock.bg, ttyclock.bg);
+    ttyclock.fg = option.color;
+    wnoutrefresh(stdscr);
 
     /* Init global struct */
     ttyclock.running = true;
@@ -329,11 +601,6 @@ init_screen(void)
     }
     ttyclock.geo.w = (option.second) ? SECFRAMEW : NORMFRAMEW;
     ttyclock.geo.h = 7;
-    ttyclock.tm = localtime(&(ttyclock.lt));
-    if(option.utc) {
-        ttyclock.tm = gmtime(&(ttyclock.lt));
-    }
-    ttyclock.lt = time(NULL);
     update_hour();
 
     /* Create clock win */
@@ -350,24 +617,32 @@ init_screen(void)
     }
 
     /* Create the date win */
-    ttyclock.datewin = newwin(DATEWINH, (int)(strlen(ttyclock.date.datestr) + 2),
+    ttyclock.datewin = newwin(DATEWINH, (int)(strlen(ttyclock.render.date.datestr) + 2),
                          (int)(ttyclock.geo.x + ttyclock.geo.h - 1),
                          (int)(ttyclock.geo.y + (ttyclock.geo.w / 2)) -
-                         (int)((strlen(ttyclock.date.datestr) / 2) - 1));
+                         (int)((strlen(ttyclock.render.date.datestr) / 2) - 1));
     if(option.box && option.date) {
         box(ttyclock.datewin, 0, 0);
     }
     clearok(ttyclock.datewin, true);
 
+    /* Create the status panel, placed below by clock_move() */
+    if (option.status) {
+        status_start();
+    }
+
     set_center(option.center);
+    if (option.analog) {
+        set_analog(true);
+    }
 
     nodelay(stdscr, true);
 
     if (option.date) {
-        wrefresh(ttyclock.datewin);
+        wnoutrefresh(ttyclock.datewin);
     }
 
-    wrefresh(ttyclock.framewin);
+    wnoutrefresh(ttyclock.framewin);
 
     attron(A_BLINK);
 
@@ -387,6 +662,8 @@ static void init_signal(void)
     sigaction(SIGTERM,  &sig, NULL);
     sigaction(SIGINT,   &sig, NULL);
     sigaction(SIGSEGV,  &sig, NULL);
+    sigaction(SIGUSR1,  &sig, NULL);
+    sigaction(SIGWINCH, &sig, NULL);
 
     return;
 }
@@ -403,6 +680,16 @@ signal_handler(int signal)
         /* FALLTHROUGH */
     case SIGTERM:
         ttyclock.running = false;
+        output_cancel();
+        break;
+        /* Dump the trace ring */
+    case SIGUSR1:
+        ttyclock.dump = true;
+        break;
+        /* Terminal resized */
+    case SIGWINCH:
+        ttyclock.resize = true;
+        output_cancel();
         break;
         /* Segmentation fault signal */
     case SIGSEGV:
@@ -422,84 +709,282 @@ signal_handler(int signal)
 static void
 clean_screen(void)
 {
+    input_stop();
+
     if (ttyclock.ttyscr) {
+        if (!isendwin()) {
+            endwin();
+        }
+        if (option.pause) {
+            output_focus(false);
+        }
+        output_finish();
+        tcsetattr((ttyclock.ftty) ? fileno(ttyclock.ftty) : STDIN_FILENO,
+                  TCSANOW, &ttyclock.tios);
         delscreen(ttyclock.ttyscr);
+    }
+    output_close();
+    record_free();
+    if (option.realtime) {
+        rt_report(stderr);
+    }
+    stats_report(stderr);
+    wallclock_report(stderr);
+    if (ttyclock.ftty) {
         fclose(ttyclock.ftty);
     }
 
+    analog_free();
+    alarm_free();
+    status_close();
+
+    trace_dump();
+    trace_free();
+
+    if (ttyclock.configfd >= 0) {
+        close(ttyclock.configfd);
+    }
+    free(ttyclock.config);
+    if (ttyclock.tzfd >= 0) {
+        close(ttyclock.tzfd);
+    }
+    if (ttyclock.clockfd >= 0) {
+        close(ttyclock.clockfd);
+    }
+
     free(ttyclock.tty);
 }
 
 
+/**
+ * Follow a new terminal size, the windows are kept
+ */
 static void
-update_hour(void)
+resize_screen(void)
 {
-    int ihour;
-    char tmpstr[128];
+    int lines, cols;
 
-    ttyclock.lt = time(NULL);
-    ttyclock.tm = localtime(&(ttyclock.lt));
-    if(option.utc) {
-        ttyclock.tm = gmtime(&(ttyclock.lt));
+    /* resizeterm() queues a KEY_RESIZE itself, so only act on a real change */
+    ttyclock.resize = false;
+    if (!output_size(&lines, &cols) || !is_term_resized(lines, cols)) {
+        return;
     }
+    resizeterm(lines, cols);
+    record_resize(cols, lines);
 
-    ihour = ttyclock.tm->tm_hour;
+    wbkgdset(stdscr, COLOR_PAIR(0));
+    clear();
+    wnoutrefresh(stdscr);
 
-    if(option.twelve) {
-        ttyclock.meridiem = ((ihour >= 12) ? PMSIGN : AMSIGN);
+    if (option.analog) {
+        set_analog(true);
     } else {
-        ttyclock.meridiem = "\0";
+        clock_move((ttyclock.geo.x + ttyclock.geo.h > LINES) ? 0 : ttyclock.geo.x,
+                   (ttyclock.geo.y + ttyclock.geo.w > COLS) ? 0 : ttyclock.geo.y,
+                   ttyclock.geo.w,
+                   ttyclock.geo.h);
+        set_center(option.center);
     }
 
-    /* Manage hour for twelve mode */
-    ihour = ((option.twelve && ihour > 12)  ? (ihour - 12) : ihour);
-    ihour = ((option.twelve && !ihour) ? 12 : ihour);
+    return;
+}
 
-    /* Set hour */
-    ttyclock.date.hour[0] = ihour / 10;
-    ttyclock.date.hour[1] = ihour % 10;
 
-    /* Set minutes */
-    ttyclock.date.minute[0] = ttyclock.tm->tm_min / 10;
-    ttyclock.date.minute[1] = ttyclock.tm->tm_min % 10;
+/**
+ * Put all the windows on the screen and write the frame in one go
+ */
+static void
+flush_frame(void)
+{
+    const uint64_t span = trace_begin();
+    uint64_t queue;
 
-    /* Set date string */
-    strncpy(ttyclock.date.old_datestr, ttyclock.date.datestr, DATE_SIZE - 1);
-    strftime(tmpstr,
-            sizeof(tmpstr),
-            option.format,
-            ttyclock.tm);
-    snprintf(ttyclock.date.datestr, DATE_SIZE, "%s%s", tmpstr, ttyclock.meridiem);
+    /* The terminal is behind, the next frame writes the newest state */
+    if (output_busy()) {
+        stats_drop();
+        trace_end("flush_frame", span);
+        return;
+    }
 
-    /* Set seconds */
-    ttyclock.date.second[0] = ttyclock.tm->tm_sec / 10;
-    ttyclock.date.second[1] = ttyclock.tm->tm_sec % 10;
+    doupdate();
+    if (ttyclock.render.sprites && !option.analog) {
+        draw_sprites();
+    }
+
+    queue = trace_begin();
+    if (!output_flush()) {
+        /* The terminal got part of the frame at most, repaint it all */
+        clearok(curscr, true);
+        sixel_invalidate(&sixel);
+    }
+    trace_end("queue", queue);
+
+    trace_end("flush_frame", span);
 
     return;
 }
 
 
+/**
+ * Put the sixel digits over the blank cells ncurses just drew
+ */
 static void
-draw_number(int n, int x, int y)
+draw_sprites(void)
 {
-    int i, sy = y;
+    const uint64_t span = trace_begin();
+    int cellw, cellh;
+    const char *buf;
+    size_t len;
+
+    /* An alarm may hide the clock */
+    output_sixel(&cellw, &cellh);
+    buf = sixel_frame(&sixel, &ttyclock.render, ttyclock.geo.x, ttyclock.geo.y,
+                      cellw, cellh,
+                      (ttyclock.fg == COLOR_HIDDEN || ttyclock.fg == ttyclock.bg) ? -1 : ttyclock.fg,
+                      option.bold, &len);
+    if (buf) {
+        output_append(buf, len);
+    }
 
-    for(i = 0; i < 30; ++i, ++sy) {
-        if(sy == y + 6) {
-            sy = y;
-            ++x;
-        }
+    trace_end("sixel", span);
 
-        if (option.bold) {
-            wattron(ttyclock.framewin, A_BLINK);
-        } else {
-            wattroff(ttyclock.framewin, A_BLINK);
-        }
+    return;
+}
+
+
+static void
+update_hour(void)
+{
+    const uint64_t span = trace_begin();
+    int cellw, cellh;
+
+    ttyclock.render.second = option.second;
+    ttyclock.render.twelve = option.twelve;
+    ttyclock.render.utc = option.utc;
+    ttyclock.render.blink = option.blink;
+    ttyclock.render.bold = option.bold;
+    ttyclock.render.effect = option.effect;
+    ttyclock.render.format = option.format;
+    ttyclock.render.sprites = (option.sixel && !option.analog
+                               && output_sixel(&cellw, &cellh));
+    render_time(&ttyclock.render, time(NULL));
+
+    trace_end("update_hour", span);
+
+    return;
+}
+
+
+/**
+ * Start, animate and end the effect of the alarms and keep the clock in its
+ * color otherwise, O(1) while none is due
+ */
+static void
+update_alarm(void)
+{
+    const time_t next = alarm_next();
+    alarm_t fired;
+    short fg;
+
+    if (next && next <= ttyclock.render.lt && alarm_fire(ttyclock.render.lt, &fired)) {
+        ttyclock.alert = fired;
+        ttyclock.alert_end = ttyclock.render.lt + fired.duration;
+    }
+
+    if (!ttyclock.alert_end) {
+        fg = option.color;
+    } else if (ttyclock.render.lt >= ttyclock.alert_end) {
+        /* Back to the clock color */
+        ttyclock.alert_end = 0;
+        fg = option.color;
+    } else if (ttyclock.alert.effect == ALARM_COLOR) {
+        fg = ttyclock.alert.color;
+    } else {
+        /* Flash: the digits are hidden every other second */
+        fg = (ttyclock.render.lt % 2) ? COLOR_HIDDEN : option.color;
+    }
+    set_fg(fg);
+
+    return;
+}
+
+
+/**
+ * Draw the clock in another color. The cells on the screen keep the pairs
+ * they were drawn with, so everything in the clock color is drawn again.
+ */
+static void
+set_fg(short fg)
+{
+    if (fg == ttyclock.fg) {
+        return;
+    }
+
+    ttyclock.fg = fg;
+    analog_invalidate();
+    sixel_invalidate(&sixel);
+    render_invalidate(&ttyclock.frame);
+    render_invalidate(&ttyclock.datebuf);
+    if (ttyclock.statuswin) {
+        draw_status();
+    }
+
+    return;
+}
 
-        wbkgdset(ttyclock.framewin, (chtype)COLOR_PAIR(number[n][i/2]));
-        mvwaddch(ttyclock.framewin, x, sy, ' ');
+
+/**
+ * Pair of a RENDER_* cell color in the current clock color
+ */
+static short
+clock_pair(int color)
+{
+    switch(color) {
+    case RENDER_BLOCK:
+        return PAIR_CLOCK(ttyclock.fg);
+    case RENDER_TEXT:
+        return PAIR_TEXT(ttyclock.fg);
+    default:
+        return 0;
+    }
+}
+
+
+/**
+ * Copy the cells of a rectangle into the window at (y, x), leaving the
+ * border alone
+ */
+static void
+draw_cells(WINDOW *win, const render_buf_t *buf, const render_rect_t *rect, int y, int x)
+{
+    const int maxy = getmaxy(win) - 1, maxx = getmaxx(win) - 1;
+    const render_cell_t *cell;
+    char mb[MB_LEN_MAX + 1];
+    mbstate_t ps;
+    size_t len;
+    int i, j;
+
+    for(i = rect->y; i < rect->y + rect->h; ++i) {
+        for(j = rect->x; j < rect->x + rect->w; ++j) {
+            cell = &buf->cells[i * buf->w + j];
+            if(!cell->ch || y + i < 1 || y + i >= maxy || x + j < 1 || x + j >= maxx) {
+                continue;
+            }
+
+            wattrset(win, ((cell->attr & RENDER_BOLD) ? A_BOLD : A_NORMAL)
+                          | ((cell->attr & RENDER_BLINK) ? A_BLINK : A_NORMAL));
+            wbkgdset(win, (chtype)COLOR_PAIR(clock_pair(cell->color)));
+            if(cell->ch < 0x80) {
+                mvwaddch(win, y + i, x + j, (chtype)cell->ch);
+            } else {
+                memset(&ps, 0, sizeof(ps));
+                if((len = wcrtomb(mb, (wchar_t)cell->ch, &ps)) != (size_t)-1) {
+                    mb[len] = '\0';
+                    mvwaddstr(win, y + i, x + j, mb);
+                }
+            }
+        }
     }
-    wrefresh(ttyclock.framewin);
 
     return;
 }
@@ -508,7 +993,8 @@ draw_number(int n, int x, int y)
 static void
 draw_clock(void)
 {
-    const int datediff = strcmp(ttyclock.date.datestr, ttyclock.date.old_datestr) ;
+    const uint64_t span = trace_begin();
+    const int datediff = strcmp(ttyclock.render.date.datestr, ttyclock.render.date.old_datestr) ;
     if (option.date && !option.rebound && datediff != 0) {
         clock_move(ttyclock.geo.x,
                  ttyclock.geo.y,
@@ -516,47 +1002,38 @@ draw_clock(void)
                  ttyclock.geo.h);
     }
 
-    /* Draw hour numbers */
-    draw_number(ttyclock.date.hour[0], 1, 1);
-    draw_number(ttyclock.date.hour[1], 1, 8);
-    chtype dotcolor = COLOR_PAIR(1);
-    if (option.blink && time(NULL) % 2 == 0) {
-        dotcolor = COLOR_PAIR(2);
-    }
-
-    /* 2 dot for number separation */
-    wbkgdset(ttyclock.framewin, dotcolor);
-    mvwaddstr(ttyclock.framewin, 2, 16, "  ");
-    mvwaddstr(ttyclock.framewin, 4, 16, "  ");
-
-    /* Draw minute numbers */
-    draw_number(ttyclock.date.minute[0], 1, 20);
-    draw_number(ttyclock.date.minute[1], 1, 27);
+    render_rect_t dirty[RENDER_RECTS];
+    int i, n;
 
-    /* Draw the date */
-    if (option.bold) {
-        wattron(ttyclock.datewin, A_BOLD);
+    if (option.analog) {
+        /* Draw the dial, only the cells under the hands are touched */
+        if (option.bold) {
+            wattron(ttyclock.framewin, A_BOLD);
+        } else {
+            wattroff(ttyclock.framewin, A_BOLD);
+        }
+        wbkgdset(ttyclock.framewin, COLOR_PAIR(PAIR_TEXT(ttyclock.fg)));
+        analog_draw(ttyclock.framewin, 1, 1, &(ttyclock.render.tm), option.second);
     } else {
-        wattroff(ttyclock.datewin, A_BOLD);
+        /* Draw the numbers and dots, only the cells which changed reach the window */
+        n = render_clock(&ttyclock.render, &ttyclock.frame, 0, 0, trace_clock(), dirty);
+        for(i = 0; i < n; ++i) {
+            draw_cells(ttyclock.framewin, &ttyclock.frame, &dirty[i], 0, 0);
+        }
     }
 
+    /* Draw the date */
     if (option.date) {
-        wbkgdset(ttyclock.datewin, (COLOR_PAIR(2)));
-        mvwprintw(ttyclock.datewin, (DATEWINH / 2), 1, "%s", ttyclock.date.datestr);
-        wrefresh(ttyclock.datewin);
+        n = render_date(&ttyclock.render, &ttyclock.datebuf, 0, 0, dirty);
+        for(i = 0; i < n; ++i) {
+            draw_cells(ttyclock.datewin, &ttyclock.datebuf, &dirty[i], DATEWINH / 2, 1);
+        }
+        wnoutrefresh(ttyclock.datewin);
     }
 
-    /* Draw second if the option is enabled */
-    if(option.second) {
-        /* Again 2 dot for number separation */
-        wbkgdset(ttyclock.framewin, dotcolor);
-        mvwaddstr(ttyclock.framewin, 2, NORMFRAMEW, "  ");
-        mvwaddstr(ttyclock.framewin, 4, NORMFRAMEW, "  ");
+    wnoutrefresh(ttyclock.framewin);
 
-        /* Draw second numbers */
-        draw_number(ttyclock.date.second[0], 1, 39);
-        draw_number(ttyclock.date.second[1], 1, 46);
-    }
+    trace_end("draw_clock", span);
 
     return;
 }
@@ -565,30 +1042,41 @@ draw_clock(void)
 static void
 clock_move(int x, int y, int w, int h)
 {
+    const uint64_t span = trace_begin();
 
     /* Erase border for a clean move */
     wbkgdset(ttyclock.framewin, COLOR_PAIR(0));
     wborder(ttyclock.framewin, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
     werase(ttyclock.framewin);
-    wrefresh(ttyclock.framewin);
+    wnoutrefresh(ttyclock.framewin);
+    analog_invalidate();
+    sixel_invalidate(&sixel);
+    render_invalidate(&ttyclock.frame);
+    render_invalidate(&ttyclock.datebuf);
 
     if (option.date) {
         wbkgdset(ttyclock.datewin, COLOR_PAIR(0));
         wborder(ttyclock.datewin, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
         werase(ttyclock.datewin);
-        wrefresh(ttyclock.datewin);
+        wnoutrefresh(ttyclock.datewin);
+    }
+    if (ttyclock.statuswin) {
+        wbkgdset(ttyclock.statuswin, COLOR_PAIR(0));
+        wborder(ttyclock.statuswin, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
+        werase(ttyclock.statuswin);
+        wnoutrefresh(ttyclock.statuswin);
     }
 
     /* Frame win move */
     mvwin(ttyclock.framewin, (ttyclock.geo.x = x), (ttyclock.geo.y = y));
-    wresize(ttyclock.framewin, (ttyclock.geo.h = h), (ttyclock.geo.w = w));
+    win_resize(ttyclock.framewin, (ttyclock.geo.h = h), (ttyclock.geo.w = w));
 
     /* Date win move */
     if (option.date) {
         mvwin(ttyclock.datewin,
              ttyclock.geo.x + ttyclock.geo.h - 1,
-             ttyclock.geo.y + (ttyclock.geo.w / 2) - (int)((strlen(ttyclock.date.datestr) / 2) - 1));
-        wresize(ttyclock.datewin, DATEWINH, (int)(strlen(ttyclock.date.datestr) + 2));
+             ttyclock.geo.y + (ttyclock.geo.w / 2) - (int)((strlen(ttyclock.render.date.datestr) / 2) - 1));
+        win_resize(ttyclock.datewin, DATEWINH, (int)(strlen(ttyclock.render.date.datestr) + 2));
 
         if (option.box) {
             box(ttyclock.datewin,  0, 0);
@@ -599,8 +1087,33 @@ clock_move(int x, int y, int w, int h)
         box(ttyclock.framewin, 0, 0);
     }
 
-    wrefresh(ttyclock.framewin);
-    wrefresh(ttyclock.datewin);
+    /* Status win move */
+    if (ttyclock.statuswin) {
+        status_place();
+    }
+
+    wnoutrefresh(ttyclock.framewin);
+    wnoutrefresh(ttyclock.datewin);
+
+    trace_end("clock_move", span);
+
+    return;
+}
+
+
+/**
+ * wresize() reallocates the lines of the window, so it is only called when
+ * the size really changes: moving the clock doesn't allocate
+ */
+static void
+win_resize(WINDOW *win, int h, int w)
+{
+    int oldh, oldw;
+
+    getmaxyx(win, oldh, oldw);
+    if (oldh != h || oldw != w) {
+        wresize(win, h, w);
+    }
 
     return;
 }
@@ -609,14 +1122,14 @@ clock_move(int x, int y, int w, int h)
 static void
 clock_rebound(void)
 {
-    if(!option.rebound) {
+    if(!option.rebound || option.analog) {
         return;
     }
 
     if(ttyclock.geo.x < 1) {
         ttyclock.geo.a = 1;
     }
-    if(ttyclock.geo.x > (LINES - ttyclock.geo.h - DATEWINH)) {
+    if(ttyclock.geo.x > (LINES - ttyclock.geo.h - DATEWINH - status_height())) {
         ttyclock.geo.a = -1;
     }
     if(ttyclock.geo.y < 1) {
@@ -641,6 +1154,13 @@ set_second(void)
     int y_adj;
     int new_w = (((option.second = !option.second)) ? SECFRAMEW : NORMFRAMEW);
 
+    if(option.analog) {
+        /* The dial keeps its size, only the second hand comes or goes */
+        analog_invalidate();
+
+        return;
+    }
+
     for(y_adj = 0; (ttyclock.geo.y - y_adj) > (COLS - new_w - 1); ++y_adj);
 
     clock_move(ttyclock.geo.x, (ttyclock.geo.y - y_adj), new_w, ttyclock.geo.h);
@@ -654,7 +1174,7 @@ set_second(void)
 static void
 set_center(bool b)
 {
-    if((option.center = b)) {
+    if((option.center = b) && !option.analog) {
         option.rebound = false;
 
         clock_move((LINES / 2 - (ttyclock.geo.h / 2)),
@@ -684,55 +1204,362 @@ set_box(bool b)
         wborder(ttyclock.framewin, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
         wborder(ttyclock.datewin, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
     }
+    if (ttyclock.statuswin) {
+        draw_status();
+    }
+
+    wnoutrefresh(ttyclock.datewin);
+    wnoutrefresh(ttyclock.framewin);
+
+    return;
+}
+
+
+static void
+set_analog(bool b)
+{
+    if((option.analog = b)) {
+        /* The dial takes the whole terminal, the date and status windows stay below */
+        clock_move(0, 0, COLS,
+                   LINES - ((option.date) ? DATEWINH - 1 : 0) - status_height());
+        analog_resize(ttyclock.geo.w - 2, ttyclock.geo.h - 2);
+    } else {
+        clock_move(0, 0, (option.second) ? SECFRAMEW : NORMFRAMEW, 7);
+        set_center(option.center);
+    }
+
+    return;
+}
+
+
+/**
+ * Apply a changed config file, repainting only the affected windows
+ */
+static void
+reload_config(void)
+{
+    option_t new = option;
+    bool moved = false;
+
+    if (!config_load(ttyclock.config, &new)) {
+        return;
+    }
+    /* As at startup, the command line wins over the file */
+    cmdline_option(&new);
+
+    option.delay = new.delay;
+    option.nsdelay = new.nsdelay;
+    option.screensaver = new.screensaver;
+    option.noquit = new.noquit;
+    update_quit();
+    option.bold = new.bold;
+    option.blink = new.blink;
+    option.utc = new.utc;
+    option.effect = new.effect;
+    if (new.pause != option.pause) {
+        option.pause = new.pause;
+        output_focus(option.pause);
+        ttyclock.unfocused = false;
+    }
+
+    /* update_alarm() draws the clock in it */
+    option.color = new.color;
+
+    if (new.twelve != option.twelve || strcmp(new.format, option.format)) {
+        option.twelve = new.twelve;
+        memcpy(option.format, new.format, FORMAT_SIZE);
+        /* Set the new ttyclock.render.date.datestr to resize date window */
+        update_hour();
+        moved = true;
+    }
+
+    if (new.date != option.date) {
+        if (!new.date) {
+            wbkgdset(ttyclock.datewin, COLOR_PAIR(0));
+            wborder(ttyclock.datewin, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
+            werase(ttyclock.datewin);
+            wnoutrefresh(ttyclock.datewin);
+        }
+        option.date = new.date;
+        moved = true;
+    }
+
+    if (new.status != option.status) {
+        option.status = new.status;
+        status_stop();
+        if (option.status) {
+            status_start();
+        }
+        moved = true;
+    }
+
+    if (new.second != option.second) {
+        set_second();
+    }
+    if (new.box != option.box) {
+        set_box(new.box);
+    }
+    if (new.sixel != option.sixel) {
+        /* The blocks and the images are swapped on a cleared frame */
+        option.sixel = new.sixel;
+        moved = true;
+    }
+    if (new.analog != option.analog || (moved && option.analog)) {
+        set_analog(new.analog);
+    } else if (moved) {
+        clock_move(ttyclock.geo.x, ttyclock.geo.y, ttyclock.geo.w, ttyclock.geo.h);
+    }
+
+    if (new.rebound != option.rebound) {
+        option.rebound = new.rebound;
+        if(option.rebound && option.center) {
+            option.center = false;
+        }
+    }
+    if (new.center != option.center) {
+        set_center(new.center);
+    }
+
+    return;
+}
+
+
+/**
+ * Shorten the wait if an alarm starts or ends before the next redraw
+ */
+static void
+alarm_timeout(struct timespec *length)
+{
+    time_t next = alarm_next();
+    struct timespec now;
+    long long left;
+
+    if (ttyclock.alert_end && (!next || ttyclock.alert_end < next)) {
+        next = ttyclock.alert_end;
+    }
+    if (!next) {
+        return;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    left = (long long)(next - now.tv_sec) * DELAYNS_MAX - now.tv_nsec;
+    if (left < 0) {
+        left = 0;
+    }
+
+    if (left < (long long)length->tv_sec * DELAYNS_MAX + length->tv_nsec) {
+        length->tv_sec = (time_t)(left / DELAYNS_MAX);
+        length->tv_nsec = (long)(left % DELAYNS_MAX);
+    }
+
+    return;
+}
+
+
+/**
+ * Open the /proc files and create the panel window, clock_move() places it
+ */
+static void
+status_start(void)
+{
+    if (ttyclock.statuswin || !status_open()) {
+        return;
+    }
+
+    ttyclock.statuswin = newwin(STATUSWINH, STATUS_WIDTH + 2, 0, 0);
+    clearok(ttyclock.statuswin, true);
+    memset(&ttyclock.status, 0, sizeof(status_t));
+    ttyclock.status_next = 0;
+    status_place();
+
+    return;
+}
+
+
+static void
+status_stop(void)
+{
+    if (!ttyclock.statuswin) {
+        return;
+    }
+
+    wbkgdset(ttyclock.statuswin, COLOR_PAIR(0));
+    wborder(ttyclock.statuswin, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
+    werase(ttyclock.statuswin);
+    wnoutrefresh(ttyclock.statuswin);
+    delwin(ttyclock.statuswin);
+    ttyclock.statuswin = NULL;
+    status_close();
+
+    return;
+}
+
+
+/**
+ * Sample the system when the panel interval is over, not on every frame
+ */
+static void
+update_status(void)
+{
+    const uint64_t now = trace_clock();
+
+    if (!ttyclock.statuswin || now < ttyclock.status_next) {
+        return;
+    }
+
+    ttyclock.status_next = now + (uint64_t)option.status * DELAYNS_MAX;
+    if (status_sample(&ttyclock.status)) {
+        draw_status();
+    }
+
+    return;
+}
+
+
+/**
+ * Draw the last sample, the lines have a fixed width and overwrite the old
+ */
+static void
+draw_status(void)
+{
+    char line[STATUS_WIDTH + 1];
+    int i;
+
+    if (option.box) {
+        wbkgdset(ttyclock.statuswin, COLOR_PAIR(0));
+        box(ttyclock.statuswin, 0, 0);
+    }
 
-    wrefresh(ttyclock.datewin);
-    wrefresh(ttyclock.framewin);
+    wattrset(ttyclock.statuswin, COLOR_PAIR(PAIR_TEXT(ttyclock.fg))
+                                 | ((option.bold) ? A_BOLD : A_NORMAL));
+    for(i = 0; i < STATUS_LINES; ++i) {
+        status_line(&ttyclock.status, i, line, sizeof(line));
+        mvwaddstr(ttyclock.statuswin, i + 1, 1, line);
+    }
+    wnoutrefresh(ttyclock.statuswin);
 
     return;
 }
 
 
+/**
+ * Center the panel below the date win, or below the frame without a date
+ */
+static void
+status_place(void)
+{
+    mvwin(ttyclock.statuswin,
+          ttyclock.geo.x + ttyclock.geo.h - 1 + ((option.date) ? DATEWINH - 1 : 0),
+          ttyclock.geo.y + (ttyclock.geo.w / 2) - (STATUS_WIDTH / 2 + 1));
+    draw_status();
+
+    return;
+}
+
+
+/**
+ * Shorten the wait if the panel is due before the next redraw. Returns true
+ * if it was shortened.
+ */
 static bool
-key_event(void)
+status_timeout(uint64_t now, struct timespec *length)
+{
+    uint64_t left;
+
+    if (!ttyclock.statuswin) {
+        return false;
+    }
+
+    left = (ttyclock.status_next > now) ? ttyclock.status_next - now : 0;
+    if (left >= (uint64_t)length->tv_sec * DELAYNS_MAX + (uint64_t)length->tv_nsec) {
+        return false;
+    }
+    length->tv_sec = (time_t)(left / DELAYNS_MAX);
+    length->tv_nsec = (long)(left % DELAYNS_MAX);
+
+    return true;
+}
+
+
+/**
+ * Rows the status panel adds below the clock and the date
+ */
+static int
+status_height(void)
+{
+    return (ttyclock.statuswin) ? STATUSWINH - 1 : 0;
+}
+
+
+/**
+ * Sleep until a key is pressed, the config file, the time zone or the wall
+ * clock changes or the delay is over. Returns false if the delay ran out.
+ */
+static bool
+wait_event(const struct timespec *length)
 {
-    struct timespec length = {
-        option.delay,
-        option.nsdelay,
-    };
+    const int keyfd = input_wakefd();
+    int64_t jump;
+    uint64_t span;
+    int nfds = keyfd;
+    int ret;
     fd_set rfds;
-    int c;
-    short i;
 
     FD_ZERO(&rfds);
-    FD_SET(STDIN_FILENO, &rfds);
+    FD_SET(keyfd, &rfds);
+    if (ttyclock.configfd >= 0) {
+        FD_SET(ttyclock.configfd, &rfds);
+        nfds = (ttyclock.configfd > nfds) ? ttyclock.configfd : nfds;
+    }
+    if (ttyclock.tzfd >= 0) {
+        FD_SET(ttyclock.tzfd, &rfds);
+        nfds = (ttyclock.tzfd > nfds) ? ttyclock.tzfd : nfds;
+    }
+    if (ttyclock.clockfd >= 0) {
+        FD_SET(ttyclock.clockfd, &rfds);
+        nfds = (ttyclock.clockfd > nfds) ? ttyclock.clockfd : nfds;
+    }
 
-    if (option.screensaver) {
-        c = wgetch(stdscr);
-        if(c != ERR && option.noquit == false) {
-            ttyclock.running = false;
-        } else {
-            nanosleep(&length, NULL);
-            for(i = 0; i < 8; ++i) {
-                if(c == (i + '0')) {
-                    option.color = i;
-                    init_pair(1, ttyclock.bg, i);
-                    init_pair(2, i, ttyclock.bg);
-                }
-            }
-        }
+    span = trace_begin();
+    ret = pselect(nfds + 1, &rfds, NULL, NULL, length, NULL);
+    trace_end("wait", span);
 
-        return true;
+    if (ret > 0
+        && ttyclock.configfd >= 0
+        && FD_ISSET(ttyclock.configfd, &rfds)
+        && config_changed(ttyclock.configfd, ttyclock.config)) {
+        reload_config();
     }
-
-    /* get keystrokes */
-    switch(c = wgetch(stdscr)) {
-    case KEY_RESIZE:
-        endwin();
-        if (!init_screen()) {
-            ttyclock.exit = EXIT_FAILURE;
-            return false;
+    if (ret > 0
+        && ttyclock.tzfd >= 0
+        && FD_ISSET(ttyclock.tzfd, &rfds)
+        && tz_changed(ttyclock.tzfd)) {
+        update_hour();
+    }
+    /* Returning true redraws at once and starts the delay again from there */
+    if (ret > 0
+        && ttyclock.clockfd >= 0
+        && FD_ISSET(ttyclock.clockfd, &rfds)
+        && wallclock_changed(ttyclock.clockfd, &jump)) {
+        stats_jump(jump);
+        /* Logged at once unless it would land on the clock, else on exit */
+        if (!isatty(STDERR_FILENO)) {
+            wallclock_report(stderr);
         }
-        break;
+        update_hour();
+        /* Often a resume, the terminal may not show what curscr says any more */
+        clearok(curscr, true);
+        sixel_invalidate(&sixel);
+    }
+
+    return (ret != 0);
+}
+
+
+static void
+key_press(int c)
+{
+    switch(c) {
     case KEY_UP:
         /* FALLTHROUGH */
     case 'k':
@@ -748,7 +1575,7 @@ key_event(void)
     case 'j':
         /* FALLTHROUGH */
     case 'J':
-        if(ttyclock.geo.x <= (LINES - ttyclock.geo.h - DATEWINH)
+        if(ttyclock.geo.x <= (LINES - ttyclock.geo.h - DATEWINH - status_height())
            && !option.center) {
             clock_move(ttyclock.geo.x + 1, ttyclock.geo.y, ttyclock.geo.w, ttyclock.geo.h);
         }
@@ -789,7 +1616,7 @@ key_event(void)
         /* FALLTHROUGH */
     case 'T':
         option.twelve = !option.twelve;
-        /* Set the new ttyclock.date.datestr to resize date window */
+        /* Set the new ttyclock.render.date.datestr to resize date window */
         update_hour();
         clock_move(ttyclock.geo.x, ttyclock.geo.y, ttyclock.geo.w, ttyclock.geo.h);
         break;
@@ -816,16 +1643,119 @@ key_event(void)
     case 'X':
         set_box(!option.box);
         break;
+    case 'a':
+        /* FALLTHROUGH */
+    case 'A':
+        set_analog(!option.analog);
+        break;
     case '0': case '1': case '2': case '3':
         /* FALLTHROUGH */
     case '4': case '5': case '6': case '7':
-        i = (short)c - '0';
-        option.color = i;
-        init_pair(1, ttyclock.bg, i);
-        init_pair(2, i, ttyclock.bg);
+        option.color = (short)(c - '0');
         break;
-    default:
-        pselect(1, &rfds, NULL, NULL, &length, NULL);
+    }
+
+    return;
+}
+
+
+/**
+ * Keys which end tty-clock, asked by the input thread for every key. It only
+ * reads the policy published by update_quit(), never the options.
+ */
+static bool
+key_quit(int c)
+{
+    const unsigned int quit = __atomic_load_n(&ttyclock.quit, __ATOMIC_ACQUIRE);
+
+    return ((quit & QUIT_ANY) || ((quit & QUIT_KEYS) && (c == 'q' || c == 'Q')));
+}
+
+
+/**
+ * Publish the keys which quit to the input thread, after the options changed
+ */
+static void
+update_quit(void)
+{
+    unsigned int quit = 0;
+
+    if (!option.noquit) {
+        quit = (option.screensaver) ? QUIT_ANY : QUIT_KEYS;
+    }
+    __atomic_store_n(&ttyclock.quit, quit, __ATOMIC_RELEASE);
+
+    return;
+}
+
+
+static bool
+key_event(void)
+{
+    struct timespec length;
+    bool pressed = false, focus = false;
+    uint64_t now, left, deadline;
+    int c;
+    short i;
+
+    /* Apply all keys the input thread has queued since the last frame */
+    input_clear();
+    while((c = input_get()) != ERR) {
+        if (c == INPUT_FOCUS_IN || c == INPUT_FOCUS_OUT) {
+            focus = (ttyclock.unfocused != (c == INPUT_FOCUS_OUT)) || focus;
+            ttyclock.unfocused = (c == INPUT_FOCUS_OUT);
+            continue;
+        }
+        pressed = true;
+
+        if (!option.screensaver) {
+            key_press(c);
+        } else if(option.noquit == false) {
+            ttyclock.running = false;
+        } else {
+            for(i = 0; i < 8; ++i) {
+                if(c == (i + '0')) {
+                    option.color = i;
+                }
+            }
+        }
+    }
+
+    if (!ttyclock.running || (!option.screensaver && pressed) || (focus && option.pause)) {
+        ttyclock.tween = false;
+        return true;
+    }
+
+    /* Paused on focus loss: only an alarm, a key, a focus report or a signal wakes it */
+    if (ttyclock.unfocused && option.pause) {
+        length.tv_sec = DELAY_UNFOCUSED;
+        length.tv_nsec = 0;
+        alarm_timeout(&length);
+        ttyclock.tween = false;
+        wait_event(&length);
+        return true;
+    }
+
+    /* Frames of a transition leave the next regular redraw where it was */
+    now = trace_clock();
+    if (!ttyclock.tween) {
+        ttyclock.tick = now + (uint64_t)option.delay * DELAYNS_MAX + (uint64_t)option.nsdelay;
+    }
+    left = (ttyclock.tick > now) ? ttyclock.tick - now : 0;
+    length.tv_sec = (time_t)(left / DELAYNS_MAX);
+    length.tv_nsec = (long)(left % DELAYNS_MAX);
+
+    alarm_timeout(&length);
+    ttyclock.tween = render_timeout(&ttyclock.render, now, &length);
+    /* A panel refresh doesn't move the regular redraw either */
+    if (status_timeout(now, &length)) {
+        ttyclock.tween = true;
+    }
+    deadline = now + (uint64_t)length.tv_sec * DELAYNS_MAX + (uint64_t)length.tv_nsec;
+    if (wait_event(&length)) {
+        ttyclock.tween = false;
+    } else if ((now = trace_clock()) > deadline) {
+        stats_wake(now - deadline);
     }
 
     return true;
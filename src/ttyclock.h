@@ -36,18 +36,35 @@
 #ifndef TTYCLOCK_H
 #define TTYCLOCK_H
 
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <termios.h>
+#include <time.h>
+#include <ncurses.h>
+#include "alarm.h"
+#include "render.h"
+#include "status.h"
+
 /* Definitions */
-#define NORMFRAMEW      35
-#define SECFRAMEW       54
+#define NORMFRAMEW      RENDER_NORMW
+#define SECFRAMEW       RENDER_SECW
 #define DATEWINH        3
-#define AMSIGN          " [AM]"
-#define PMSIGN          " [PM]"
-#define DATE_SIZE       256
+#define STATUSWINH      (STATUS_LINES + 2)
+#define DATE_SIZE       RENDER_DATE_SIZE
 #define FORMAT_SIZE     100
 #define DELAY_DEFAULT   1
 #define DELAY_MAX       100
 #define DELAYNS_DEFAULT 0
 #define DELAYNS_MAX     1000000000
+#define DELAY_UNFOCUSED 3600 /* s, longest sleep while paused */
+#define QUIT_KEYS       1 /* q and Q end tty-clock */
+#define QUIT_ANY        2 /* every key does, screensaver mode */
+#define COLOR_HIDDEN    8 /* a flash draws the clock in the background color */
+#define PAIR_CLOCK(c)   (short)(1 + 2 * (c)) /* color c as background, the blocks */
+#define PAIR_TEXT(c)    (short)(2 + 2 * (c)) /* color c on the background */
+#define OPTSTRING       "iuvsScbtrhBxnDAGkHQC:f:d:T:a:F:P:L:R:e:p:K:"
 
 /* Global ttyclock struct */
 typedef struct {
@@ -55,10 +72,36 @@ typedef struct {
     SCREEN *ttyscr;
     char *tty;
     FILE *ftty;
+    struct termios tios;
     short bg;
+    /* color the clock is drawn in, 0-7 or COLOR_HIDDEN (see set_fg()) */
+    short fg;
+
+    /* config file */
+    char *config;
+    int configfd;
+    /* command line, applied again after each reload of the file */
+    int argc;
+    char **argv;
+
+    /* time zone watch */
+    int tzfd;
+
+    /* wall clock step watch */
+    int clockfd;
 
-    /* while() boolean */
-    bool running;
+    /* while() boolean, cleared by signal_handler() */
+    volatile sig_atomic_t running;
+    /* this frame only steps a digit transition */
+    bool tween;
+    /* trace dump requested (SIGUSR1) */
+    volatile sig_atomic_t dump;
+    /* terminal size changed (SIGWINCH) */
+    volatile sig_atomic_t resize;
+    /* the terminal reported it lost the focus */
+    bool unfocused;
+    /* QUIT_* keys, read by the input thread (see update_quit()) */
+    unsigned int quit;
 
     /* exit code of a subroutine */
     char pad_exit[5];
@@ -71,31 +114,36 @@ typedef struct {
         int a, b;
     } geo;
 
-    /* Date content ([2] = number by number) */
-    struct {
-        int hour[2];
-        int minute[2];
-        int second[2];
-        char datestr[DATE_SIZE];
-        char old_datestr[DATE_SIZE];
-    } date;
-
-    /* time.h utils */
-    char pad_time[4];
-    struct tm *tm;
-    time_t lt;
+    /* Time, digits and date, drawn into the cells of the windows */
+    render_t render;
+    render_buf_t frame;
+    render_buf_t datebuf;
+
+    /* next regular redraw (monotonic ns) */
+    uint64_t tick;
+
+    /* System status panel, sampled again at status_next (monotonic ns) */
+    status_t status;
+    uint64_t status_next;
+
+    /* Alarm being shown, until alert_end (0 if none) */
+    alarm_t alert;
+    time_t alert_end;
 
     /* Clock member */
-    char *meridiem;
     WINDOW *framewin;
     WINDOW *datewin;
+    WINDOW *statuswin; /* NULL if the panel is off */
 } ttyclock_t;
 
 /* Running option */
 typedef struct {
     long delay;
     long nsdelay;
+    long status; /* panel interval in seconds, 0 if off */
     short color;
+    short effect;
+    short cpu; /* realtime mode pins to it, -1 for none */
     char format[100];
     bool second:1;
     bool screensaver:1;
@@ -108,7 +156,12 @@ typedef struct {
     bool noquit:1;
     bool bold:1;
     bool blink:1;
-    int pad:5; /* alignment */
+    bool analog:1;
+    bool sixel:1;
+    bool realtime:1;
+    bool pause:1; /* pause while the terminal doesn't have the focus */
+    bool repquery:1; /* try REP even if terminfo doesn't list it */
+    int pad:1; /* alignment */
 } option_t;
 
 #endif /* TTYCLOCK_H */
@@ -0,0 +1,347 @@
+/*
+ *     TTY-CLOCK ttyreplay.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Replays a recording made with tty-clock -R on standard output, at the
+ * original speed or as fast as the terminal takes it, and reports how many
+ * bytes were written and how long it took.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rep.h"
+
+#define REPLAY_USAGE "usage : tty-replay [-mnr] [-s speed] file\n" \
+                     "    -m          Replay as fast as possible              \n" \
+                     "    -n          Don't write, only count the bytes         \n" \
+                     "    -r          Send runs with REP, as for a terminal with it\n" \
+                     "    -s speed    Speed factor for the original timing       \n"
+
+/* Replay settings and counters */
+static struct {
+    bool max;
+    bool count;
+    bool rep;
+    rep_t runs;
+    double speed;
+    size_t events;
+    size_t bytes;
+    struct timespec start;
+} replay;
+
+
+/* Prototypes */
+static double elapsed(void);
+static void put_utf8(char **out, unsigned long c);
+static bool hex4(const char *in, unsigned long *c);
+static bool unescape(const char *in, char *out, size_t *len);
+static bool parse(char *line, double *when, char *type, char **data, size_t *len);
+static bool write_all(const char *buf, size_t len);
+static void wait_until(double when);
+
+
+static double
+elapsed(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)(now.tv_sec - replay.start.tv_sec)
+           + (double)(now.tv_nsec - replay.start.tv_nsec) / 1e9;
+}
+
+
+static void
+put_utf8(char **out, unsigned long c)
+{
+    char *p = *out;
+
+    if(c < 0x80) {
+        *p++ = (char)c;
+    } else if(c < 0x800) {
+        *p++ = (char)(0xc0 | (c >> 6));
+        *p++ = (char)(0x80 | (c & 0x3f));
+    } else if(c < 0x10000) {
+        *p++ = (char)(0xe0 | (c >> 12));
+        *p++ = (char)(0x80 | ((c >> 6) & 0x3f));
+        *p++ = (char)(0x80 | (c & 0x3f));
+    } else {
+        *p++ = (char)(0xf0 | (c >> 18));
+        *p++ = (char)(0x80 | ((c >> 12) & 0x3f));
+        *p++ = (char)(0x80 | ((c >> 6) & 0x3f));
+        *p++ = (char)(0x80 | (c & 0x3f));
+    }
+    *out = p;
+
+    return;
+}
+
+
+/**
+ * Four hex digits of a \u escape, without reading past the end of the string
+ */
+static bool
+hex4(const char *in, unsigned long *c)
+{
+    char hex[5] = "";
+    int i;
+
+    for(i = 0; i < 4; ++i) {
+        if(!isxdigit((unsigned char)in[i])) {
+            return false;
+        }
+        hex[i] = in[i];
+    }
+    *c = strtoul(hex, NULL, 16);
+
+    return true;
+}
+
+
+/**
+ * Decode the JSON string starting after its opening quote, in place safe as
+ * the output is never longer than the input. False on a malformed escape.
+ */
+static bool
+unescape(const char *in, char *out, size_t *len)
+{
+    char *start = out;
+    unsigned long c, lo;
+
+    while(*in && *in != '"') {
+        if(*in != '\\') {
+            *out++ = *in++;
+            continue;
+        }
+        switch(*++in) {
+        case 'b': *out++ = '\b'; break;
+        case 'f': *out++ = '\f'; break;
+        case 'n': *out++ = '\n'; break;
+        case 'r': *out++ = '\r'; break;
+        case 't': *out++ = '\t'; break;
+        case 'u':
+            if(!hex4(in + 1, &c)) {
+                return false;
+            }
+            in += 4;
+            /* surrogate pair */
+            if(c >= 0xd800 && c < 0xdc00 && in[1] == '\\' && in[2] == 'u') {
+                if(!hex4(in + 3, &lo) || lo < 0xdc00 || lo >= 0xe000) {
+                    return false;
+                }
+                c = 0x10000 + ((c - 0xd800) << 10) + (lo - 0xdc00);
+                in += 6;
+            }
+            put_utf8(&out, c);
+            break;
+        case '\0':
+            return false;
+        default:
+            *out++ = *in;
+            break;
+        }
+        ++in;
+    }
+    if(*in != '"') {
+        return false;
+    }
+    *len = (size_t)(out - start);
+
+    return true;
+}
+
+
+/**
+ * Split an event line [time, "type", "data"], data is decoded in place
+ */
+static bool
+parse(char *line, double *when, char *type, char **data, size_t *len)
+{
+    char *p;
+
+    if(*line != '[') {
+        return false;
+    }
+    *when = strtod(line + 1, &p);
+    if(p == line + 1 || !(p = strchr(p, '"'))) {
+        return false;
+    }
+    *type = p[1];
+    if(!(p = strchr(p + 1, '"')) || !(p = strchr(p + 1, '"'))) {
+        return false;
+    }
+    *data = p + 1;
+
+    return unescape(p + 1, p + 1, len);
+}
+
+
+static bool
+write_all(const char *buf, size_t len)
+{
+    ssize_t n;
+
+    while(len) {
+        if((n = write(STDOUT_FILENO, buf, len)) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return true;
+}
+
+
+/**
+ * Sleep until the event is due at the chosen speed
+ */
+static void
+wait_until(double when)
+{
+    struct timespec at = replay.start;
+    double left;
+
+    if(replay.max || replay.count) {
+        return;
+    }
+
+    left = when / replay.speed;
+    at.tv_sec += (time_t)left;
+    at.tv_nsec += (long)((left - (double)(time_t)left) * 1e9);
+    if(at.tv_nsec >= 1000000000L) {
+        at.tv_sec += 1;
+        at.tv_nsec -= 1000000000L;
+    }
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL) == EINTR) {
+        ;
+    }
+
+    return;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    char *line = NULL, *data;
+    size_t size = 0, len;
+    double when, took;
+    FILE *file;
+    char type;
+    int c;
+
+    replay.speed = 1.0;
+    while((c = getopt(argc, argv, "mnrs:h")) != -1) {
+        switch(c) {
+        case 'm':
+            replay.max = true;
+            break;
+        case 'n':
+            replay.count = true;
+            break;
+        case 'r':
+            replay.rep = true;
+            break;
+        case 's':
+            if((replay.speed = atof(optarg)) <= 0) {
+                fprintf(stderr, "ERROR: the speed must be above 0.\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'h':
+        default:
+            fputs(REPLAY_USAGE, stderr);
+            return (c == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if(optind != argc - 1) {
+        fputs(REPLAY_USAGE, stderr);
+        return EXIT_FAILURE;
+    }
+
+    if(!(file = fopen(argv[optind], "r"))) {
+        fprintf(stderr, "ERROR: couldn't read '%s': %s.\n",
+                argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    /* The header only describes the terminal */
+    if(getline(&line, &size, file) == -1 || *line != '{') {
+        fprintf(stderr, "ERROR: '%s' is not a recording.\n", argv[optind]);
+        free(line);
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &replay.start);
+    while(getline(&line, &size, file) != -1) {
+        if(!parse(line, &when, &type, &data, &len) || type != 'o') {
+            continue;
+        }
+        if(replay.rep) {
+            len = rep_encode(&replay.runs, data, len);
+        }
+        wait_until(when);
+        if(!replay.count && !write_all(data, len)) {
+            break;
+        }
+        replay.events++;
+        replay.bytes += len;
+    }
+    took = elapsed();
+
+    free(line);
+    fclose(file);
+
+    fprintf(stderr, "%zu frames, %zu bytes in %.3fs", replay.events, replay.bytes, took);
+    if(!replay.count && took > 0) {
+        fprintf(stderr, " (%.1f KiB/s)", (double)replay.bytes / 1024 / took);
+    }
+    fputc('\n', stderr);
+
+    return EXIT_SUCCESS;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,223 @@
+/*
+ *     TTY-CLOCK tz.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include "tz.h"
+
+/*
+ * The zone file and, if it is a symlink like /etc/localtime usually is, its
+ * target in the zoneinfo directory. Both are watched through their
+ * directory, as they are replaced rather than rewritten.
+ */
+static struct {
+    int fd;
+    int wd[2];
+    char name[2][TZ_SIZE];
+} tz = { .fd = -1, .wd = {-1, -1} };
+
+
+/* Prototypes */
+static void zone_path(char *path, size_t size);
+static void watch(int i, const char *path);
+static void arm(void);
+static void reload(void);
+
+
+/**
+ * Path of the zone file the C library reads
+ */
+static void
+zone_path(char *path, size_t size)
+{
+    const char *env = getenv("TZ");
+    const char *dir = getenv("TZDIR");
+
+    if(env && *env == ':') {
+        ++env;
+    }
+
+    if(!env || !*env) {
+        snprintf(path, size, "%s", TZ_DEFAULT);
+    } else if(*env == '/') {
+        snprintf(path, size, "%s", env);
+    } else {
+        snprintf(path, size, "%s/%s", (dir && *dir) ? dir : TZ_DIR, env);
+    }
+
+    return;
+}
+
+
+static void
+watch(int i, const char *path)
+{
+#ifdef __linux__
+    const char *name = strrchr(path, '/');
+    char dir[PATH_MAX];
+
+    if(!name) {
+        return;
+    }
+
+    snprintf(dir, sizeof(dir), "%.*s", (int)(name - path), path);
+    snprintf(tz.name[i], TZ_SIZE, "%s", name + 1);
+    tz.wd[i] = inotify_add_watch(tz.fd, (*dir) ? dir : "/",
+                                 IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+#else
+    (void)i;
+    (void)path;
+#endif
+
+    return;
+}
+
+
+/**
+ * (Re)place the watches, the symlink may point somewhere else now
+ */
+static void
+arm(void)
+{
+    char path[PATH_MAX], real[PATH_MAX];
+    int i;
+
+#ifdef __linux__
+    for(i = 0; i < 2; ++i) {
+        if(tz.wd[i] >= 0) {
+            inotify_rm_watch(tz.fd, tz.wd[i]);
+        }
+    }
+#endif
+    for(i = 0; i < 2; ++i) {
+        tz.wd[i] = -1;
+        tz.name[i][0] = '\0';
+    }
+
+    zone_path(path, sizeof(path));
+    watch(0, path);
+    if(realpath(path, real) && strcmp(path, real)) {
+        watch(1, real);
+    }
+
+    return;
+}
+
+
+/**
+ * Make the C library read the zone again. glibc only does so in tzset() if
+ * TZ differs from the last call, so a set TZ is toggled once.
+ */
+static void
+reload(void)
+{
+    const char *env = getenv("TZ");
+    char save[TZ_SIZE];
+
+    if(env && strlen(env) < sizeof(save)) {
+        strncpy(save, env, sizeof(save));
+        setenv("TZ", "UTC0", 1);
+        tzset();
+        setenv("TZ", save, 1);
+    }
+    tzset();
+
+    return;
+}
+
+
+/**
+ * Resolve the zone once, so that localtime_r() needn't look at it again, and
+ * watch its files. Returns the fd to wait on or -1.
+ */
+int
+tz_watch(void)
+{
+    tzset();
+
+#ifdef __linux__
+    if((tz.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+        return -1;
+    }
+    arm();
+#endif
+
+    return tz.fd;
+}
+
+
+/**
+ * Drain the pending events and reload the zone if one of its files changed
+ */
+bool
+tz_changed(int fd)
+{
+    bool changed = false;
+#ifdef __linux__
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev;
+    ssize_t len;
+    char *p;
+    int i;
+
+    while((len = read(fd, buf, sizeof(buf))) > 0) {
+        for(p = buf; p < buf + len; p += sizeof(struct inotify_event) + ev->len) {
+            ev = (const struct inotify_event *)p;
+            for(i = 0; i < 2; ++i) {
+                if(ev->len && ev->wd == tz.wd[i] && !strcmp(ev->name, tz.name[i])) {
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    if(changed) {
+        reload();
+        arm();
+    }
+#else
+    (void)fd;
+#endif
+
+    return changed;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,227 @@
+/*
+ *     TTY-CLOCK wallclock.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+#include "wallclock.h"
+
+/* CLOCK_REALTIME - CLOCK_MONOTONIC when the timer was set, in ns */
+static int64_t offset;
+
+/* Where the offset is read from, the tests fake it */
+static int64_t clock_offset(void);
+static int64_t (*source)(void) = clock_offset;
+
+/* The steps not reported yet, the oldest ones go first */
+static struct {
+    struct {
+        time_t at;
+        int64_t jump; /* ns */
+    } step[WALLCLOCK_LOG];
+    unsigned int count;
+    unsigned long lost;
+} steps;
+
+
+/* Prototypes */
+static bool arm(int fd);
+static void log_step(int64_t jump);
+
+
+static int64_t
+clock_offset(void)
+{
+    struct timespec real, mono;
+
+    clock_gettime(CLOCK_REALTIME, &real);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+
+    return ((int64_t)real.tv_sec - (int64_t)mono.tv_sec) * 1000000000
+           + (real.tv_nsec - mono.tv_nsec);
+}
+
+
+/**
+ * Set the timer far ahead with cancel-on-set, the kernel cancels it as soon
+ * as the wall clock is stepped
+ */
+static bool
+arm(int fd)
+{
+#ifdef __linux__
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    clock_gettime(CLOCK_REALTIME, &its.it_value);
+    its.it_value.tv_sec += WALLCLOCK_AHEAD;
+
+    return (timerfd_settime(fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &its, NULL) == 0);
+#else
+    (void)fd;
+
+    return false;
+#endif
+}
+
+
+static void
+log_step(int64_t jump)
+{
+    unsigned int i;
+
+    if(steps.count == WALLCLOCK_LOG) {
+        memmove(steps.step, steps.step + 1, (WALLCLOCK_LOG - 1) * sizeof(steps.step[0]));
+        --steps.count;
+        ++steps.lost;
+    }
+    i = steps.count++;
+    steps.step[i].at = time(NULL);
+    steps.step[i].jump = jump;
+
+    return;
+}
+
+
+/**
+ * Returns an fd which becomes readable when the wall clock is stepped
+ * (settimeofday, NTP steps, resume from suspend), -1 if not supported
+ */
+int
+wallclock_watch(void)
+{
+#ifdef __linux__
+    int fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    offset = source();
+    if(fd >= 0 && !arm(fd)) {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+
+/**
+ * To call when fd is readable. Returns true if the wall clock was stepped,
+ * by jump ns (negative if it went back).
+ */
+bool
+wallclock_changed(int fd, int64_t *jump)
+{
+    uint64_t expired;
+    bool stepped;
+
+    if(read(fd, &expired, sizeof(expired)) != -1) {
+        /* A year went by, just set it again */
+        stepped = false;
+    } else if(errno == ECANCELED) {
+        stepped = true;
+    } else {
+        return false;
+    }
+
+    *jump = wallclock_rearm(fd);
+    if(stepped) {
+        log_step(*jump);
+    }
+
+    return stepped;
+}
+
+
+/**
+ * Set the timer again. Returns how far the wall clock moved against the
+ * monotonic clock since it was last set, in ns.
+ */
+int64_t
+wallclock_rearm(int fd)
+{
+    const int64_t last = offset;
+
+    offset = source();
+    arm(fd);
+
+    return offset - last;
+}
+
+
+/**
+ * Read CLOCK_REALTIME - CLOCK_MONOTONIC in ns from get instead, so that a
+ * test can step a clock of its own. NULL goes back to the real clocks.
+ */
+void
+wallclock_source(int64_t (*get)(void))
+{
+    source = (get) ? get : clock_offset;
+
+    return;
+}
+
+
+/**
+ * Write the steps seen since the last report, one a line
+ */
+void
+wallclock_report(FILE *file)
+{
+    char when[32];
+    struct tm tm;
+    unsigned int i;
+
+    if(steps.lost) {
+        fprintf(file, "wall clock stepped %lu more times before\n", steps.lost);
+    }
+    for(i = 0; i < steps.count; ++i) {
+        localtime_r(&steps.step[i].at, &tm);
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+        fprintf(file, "wall clock stepped by %+.3fs at %s\n",
+                (double)steps.step[i].jump / 1e9, when);
+    }
+    steps.count = 0;
+    steps.lost = 0;
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
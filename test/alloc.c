@@ -0,0 +1,182 @@
+/*
+ *     TTY-CLOCK alloc.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Preloaded into tty-clock by check-alloc: counts the calls to the allocator
+ * and the blocks alive into a shared file, and passes them on to glibc.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "alloc.h"
+
+/* What glibc's own functions are exported as */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+extern void __libc_free(void *ptr);
+
+/* NULL until the file is mapped, allocations before are not counted */
+static alloc_count_t *count;
+
+
+/* Prototypes */
+static void count_new(void *ptr);
+static void setup(void) __attribute__((constructor));
+
+
+static void
+count_new(void *ptr)
+{
+    if(count) {
+        __atomic_add_fetch(&count->calls, 1, __ATOMIC_RELAXED);
+        if(ptr) {
+            __atomic_add_fetch(&count->live, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    return;
+}
+
+
+static void
+setup(void)
+{
+    const char *path = getenv(ALLOC_ENV);
+    void *map;
+    int fd;
+
+    if(!path || (fd = open(path, O_RDWR)) == -1) {
+        return;
+    }
+    map = mmap(NULL, sizeof(alloc_count_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map != MAP_FAILED) {
+        count = map;
+    }
+
+    return;
+}
+
+
+void *
+malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+
+    count_new(ptr);
+
+    return ptr;
+}
+
+
+void *
+calloc(size_t n, size_t size)
+{
+    void *ptr = __libc_calloc(n, size);
+
+    count_new(ptr);
+
+    return ptr;
+}
+
+
+void *
+realloc(void *ptr, size_t size)
+{
+    void *new = __libc_realloc(ptr, size);
+
+    if(ptr) {
+        /* The block is only moved, or freed for a size of 0 */
+        if(count) {
+            __atomic_add_fetch(&count->calls, 1, __ATOMIC_RELAXED);
+            if(!size) {
+                __atomic_sub_fetch(&count->live, 1, __ATOMIC_RELAXED);
+            }
+        }
+    } else {
+        count_new(new);
+    }
+
+    return new;
+}
+
+
+void *
+memalign(size_t align, size_t size)
+{
+    void *ptr = __libc_memalign(align, size);
+
+    count_new(ptr);
+
+    return ptr;
+}
+
+
+void *
+aligned_alloc(size_t align, size_t size)
+{
+    return memalign(align, size);
+}
+
+
+int
+posix_memalign(void **ptr, size_t align, size_t size)
+{
+    if(!(*ptr = memalign(align, size))) {
+        return ENOMEM;
+    }
+
+    return 0;
+}
+
+
+void
+free(void *ptr)
+{
+    if(ptr && count) {
+        __atomic_sub_fetch(&count->live, 1, __ATOMIC_RELAXED);
+    }
+    __libc_free(ptr);
+
+    return;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,163 @@
+/*
+ *     TTY-CLOCK bench_alarm.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Benchmarks the alarm heap: the cost of a tick while no alarm is due,
+ * which must not grow with the number of alarms loaded, and the cost of a
+ * tick which fires one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "alarm.h"
+
+#define BENCH_TICKS 10000000
+#define BENCH_FIRES 10000
+
+/* Alarms per run, up to the 100k the engine has to cope with */
+static const size_t counts[] = { 100, 1000, 10000, 100000 };
+
+
+/* Prototypes */
+static double elapsed(const struct timespec *start);
+static bool write_alarms(const char *path, size_t count, time_t first);
+static bool tick(time_t now);
+
+
+static double
+elapsed(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)(now.tv_sec - start->tv_sec) * 1e9 + (double)(now.tv_nsec - start->tv_nsec);
+}
+
+
+/**
+ * One dated alarm a second from first on, in the order the lines of a real
+ * file would come: shuffled
+ */
+static bool
+write_alarms(const char *path, size_t count, time_t first)
+{
+    char date[32];
+    struct tm tm;
+    FILE *file;
+    size_t i, j;
+    time_t when;
+
+    if(!(file = fopen(path, "w"))) {
+        return false;
+    }
+
+    srand(1);
+    for(i = 0; i < count; ++i) {
+        j = (size_t)rand() % count;
+        when = first + (time_t)j;
+        localtime_r(&when, &tm);
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+        fprintf(file, "%s 5 color %zu\n", date, j % 8);
+    }
+
+    return (fclose(file) == 0);
+}
+
+
+/**
+ * What update_alarm() does on every tick
+ */
+static bool
+tick(time_t now)
+{
+    const time_t next = alarm_next();
+    alarm_t fired;
+
+    return (next && next <= now && alarm_fire(now, &fired));
+}
+
+
+int
+main(void)
+{
+    char path[] = "/tmp/tty-clock-alarms.XXXXXX";
+    struct timespec start;
+    const time_t now = time(NULL), first = now + 86400;
+    time_t next;
+    volatile bool sink = false;
+    size_t i, c, fired;
+    double idle, fire;
+    int fd;
+
+    if((fd = mkstemp(path)) == -1) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    printf("%10s %14s %14s\n", "alarms", "idle tick ns", "firing tick ns");
+    for(c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        if(!write_alarms(path, counts[c], first) || !alarm_load(path, now)) {
+            perror(path);
+            unlink(path);
+            return EXIT_FAILURE;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(i = 0; i < BENCH_TICKS; ++i) {
+            sink = tick(now);
+        }
+        idle = elapsed(&start) / BENCH_TICKS;
+
+        /* Straight to the next alarm every tick, so that each one fires */
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(fired = 0; fired < BENCH_FIRES && (next = alarm_next()); ++fired) {
+            sink = tick(next);
+        }
+        fire = elapsed(&start) / (double)((fired) ? fired : 1);
+
+        printf("%10zu %14.2f %14.2f\n", counts[c], idle, fire);
+        alarm_free();
+    }
+    (void)sink;
+
+    unlink(path);
+
+    return EXIT_SUCCESS;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,242 @@
+/*
+ *     TTY-CLOCK bench_embed.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Compares the two ways of putting clocks on a dashboard: drawing them with
+ * libtty-clock into cells the dashboard owns, or running a tty-clock for each
+ * on a pty of its own. Both draw one frame a second with the seconds shown,
+ * the cost is given per clock and second of clock.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "render.h"
+
+#define BENCH_CLOCKS  8
+#define BENCH_SECONDS 5
+#define BENCH_FRAMES  100000 /* per clock */
+#define BENCH_BIN     "bin/tty-clock"
+
+/* A clock of the dashboard, drawn by the library */
+typedef struct {
+    render_t render;
+    render_cell_t frame[RENDER_HEIGHT * RENDER_SECW];
+    render_cell_t date[RENDER_DATE_SIZE];
+} widget_t;
+
+/* A clock of the dashboard, run as a subprocess */
+typedef struct {
+    pid_t pid;
+    int fd;
+    double first; /* ms from the fork to its first output, 0 before */
+} child_t;
+
+static widget_t widgets[BENCH_CLOCKS];
+static child_t children[BENCH_CLOCKS];
+
+
+/* Prototypes */
+static double elapsed(const struct timespec *start);
+static double embedded(void);
+static bool subprocess(double *cpu, double *rss, double *first);
+
+
+static double
+elapsed(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)(now.tv_sec - start->tv_sec) * 1e9 + (double)(now.tv_nsec - start->tv_nsec);
+}
+
+
+/**
+ * ns to draw a frame of one clock, its time and date included. Every frame
+ * is a second later than the one before, so digits change as they would.
+ */
+static double
+embedded(void)
+{
+    render_rect_t dirty[RENDER_RECTS];
+    render_buf_t frame, date;
+    struct timespec start;
+    const time_t now = time(NULL);
+    volatile int sink = 0;
+    int i, c;
+
+    for(c = 0; c < BENCH_CLOCKS; ++c) {
+        render_init(&widgets[c].render);
+        widgets[c].render.second = true;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < BENCH_FRAMES; ++i) {
+        for(c = 0; c < BENCH_CLOCKS; ++c) {
+            frame = (render_buf_t) { widgets[c].frame, RENDER_SECW, RENDER_HEIGHT };
+            date = (render_buf_t) { widgets[c].date, RENDER_DATE_SIZE, 1 };
+            if(!i) {
+                render_invalidate(&frame);
+                render_invalidate(&date);
+            }
+            render_time(&widgets[c].render, now + i);
+            sink = render_clock(&widgets[c].render, &frame, 0, 0,
+                                (uint64_t)i * 1000000000u, dirty);
+            sink = render_date(&widgets[c].render, &date, 0, 0, dirty);
+        }
+    }
+    (void)sink;
+
+    return elapsed(&start) / ((double)BENCH_FRAMES * BENCH_CLOCKS);
+}
+
+
+/**
+ * Run a tty-clock -s for each clock for BENCH_SECONDS, reading what they
+ * write as a dashboard would. Their cpu time (us a second), peak RSS (KB)
+ * and startup (ms) are averaged.
+ */
+static bool
+subprocess(double *cpu, double *rss, double *first)
+{
+    const struct winsize ws = { RENDER_HEIGHT + 3, RENDER_SECW + 2, 0, 0 };
+    struct pollfd pfd[BENCH_CLOCKS];
+    struct timespec start, spawned[BENCH_CLOCKS];
+    struct rusage ru;
+    char buf[4096];
+    int c, status, open;
+    bool quit = false;
+
+    *cpu = *rss = *first = 0;
+    setenv("TERM", "xterm-256color", 1);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(c = 0; c < BENCH_CLOCKS; ++c) {
+        clock_gettime(CLOCK_MONOTONIC, &spawned[c]);
+        children[c].first = 0;
+        if((children[c].pid = forkpty(&children[c].fd, NULL, NULL, &ws)) == -1) {
+            return false;
+        }
+        if(!children[c].pid) {
+            execl(BENCH_BIN, "tty-clock", "-s", (char *)NULL);
+            _exit(127);
+        }
+        pfd[c].fd = children[c].fd;
+        pfd[c].events = POLLIN;
+    }
+
+    /* Drain the ptys, then ask each clock to quit and drain until it did */
+    for(open = BENCH_CLOCKS; open; ) {
+        if(!quit && elapsed(&start) > BENCH_SECONDS * 1e9) {
+            for(c = 0; c < BENCH_CLOCKS; ++c) {
+                if(write(children[c].fd, "q", 1) != 1) {
+                    kill(children[c].pid, SIGTERM);
+                }
+            }
+            quit = true;
+        }
+        if(poll(pfd, BENCH_CLOCKS, 100) == -1 && errno != EINTR) {
+            return false;
+        }
+        for(c = 0; c < BENCH_CLOCKS; ++c) {
+            if(pfd[c].fd == -1 || !pfd[c].revents) {
+                continue;
+            }
+            if(read(pfd[c].fd, buf, sizeof(buf)) > 0) {
+                if(!children[c].first) {
+                    children[c].first = elapsed(&spawned[c]) / 1e6;
+                }
+                continue;
+            }
+            /* The clock closed its side */
+            close(pfd[c].fd);
+            pfd[c].fd = -1;
+            --open;
+        }
+    }
+
+    for(c = 0; c < BENCH_CLOCKS; ++c) {
+        if(wait4(children[c].pid, &status, 0, &ru) == -1
+           || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            fprintf(stderr, "ERROR: %s didn't run.\n", BENCH_BIN);
+            return false;
+        }
+        *cpu += (double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6
+                + (double)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+        *rss += (double)ru.ru_maxrss;
+        *first += children[c].first;
+    }
+    *cpu /= BENCH_CLOCKS * (double)BENCH_SECONDS;
+    *rss /= BENCH_CLOCKS;
+    *first /= BENCH_CLOCKS;
+
+    return true;
+}
+
+
+int
+main(void)
+{
+    double frame, cpu, rss, first;
+
+    frame = embedded();
+    if(!subprocess(&cpu, &rss, &first)) {
+        perror(BENCH_BIN);
+        return EXIT_FAILURE;
+    }
+
+    printf("%d clocks, one frame a second each\n", BENCH_CLOCKS);
+    printf("%-12s %16s %14s %14s\n", "", "cpu us/clock/s", "KB/clock", "startup ms");
+    printf("%-12s %16.2f %14.1f %14s\n", "embedded", frame / 1e3,
+           (double)sizeof(widget_t) / 1024, "-");
+    printf("%-12s %16.2f %14.1f %14.2f\n", "subprocess", cpu, rss, first);
+
+    return EXIT_SUCCESS;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,25 @@
+#!/bin/sh
+#
+# Bytes of each kind of frame as written to a terminal without REP, and with
+# it (tty-replay -r encodes the runs as tty-clock does). The recordings in
+# test/data were made with -R on an 80x24 xterm-256color pty, by a tty-clock
+# which didn't send REP yet:
+#
+#   full     six resizes, each of them a full redraw
+#   box      the box toggled eight times with x
+#   rebound  -s -r, a frame every 100ms
+#   ticks    five seconds of -s -c
+#   analog   -A, three seconds and a resize
+
+REPLAY=${REPLAY:-bin/tty-replay}
+
+printf '%-10s %8s %10s %10s %8s\n' recording frames bytes "with REP" saved
+for cast in test/data/*.cast; do
+    plain=$(${REPLAY} -n "${cast}" 2>&1) || exit 1
+    rep=$(${REPLAY} -n -r "${cast}" 2>&1) || exit 1
+    echo "$(basename "${cast}" .cast) ${plain} ${rep}" | awk '{
+        printf "%-10s %8d %10d %10d %7.1f%%\n", $1, $2, $4, $10, ($4 - $10) * 100 / $4
+    }'
+done
+
+# vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
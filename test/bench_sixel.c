@@ -0,0 +1,148 @@
+/*
+ *     TTY-CLOCK bench_sixel.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Benchmarks sixel_frame(): the time to encode and the bytes of a frame
+ * drawn with an empty sprite cache, of one redrawn from the cache, and of
+ * the frame of the next second, for a few cell sizes.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "anim.h"
+#include "render.h"
+#include "sixel.h"
+
+#define BENCH_FRAMES 20000
+#define COLOR        2
+#define TIME         45296 /* 1970-01-01 12:34:56 UTC */
+
+/* Cell sizes in pixels, from a small font to a HiDPI one */
+static const int sizes[][2] = { { 6, 12 }, { 10, 20 }, { 16, 32 } };
+
+/* A frame kind: its sixel_t is prepared before each frame is timed */
+enum {
+    COLD,   /* nothing encoded */
+    CACHED, /* everything has to be drawn again, from the cache */
+    TICK,   /* one second later */
+    KINDS
+};
+
+static const char *const names[KINDS] = { "cold", "cached", "tick" };
+
+static render_t render;
+static render_cell_t cells[RENDER_HEIGHT * RENDER_SECW];
+static sixel_t sixel;
+
+
+/* Prototypes */
+static uint64_t now_ns(void);
+static void bench(int kind, int cellw, int cellh, double *ns, double *bytes);
+
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+
+static void
+bench(int kind, int cellw, int cellh, double *ns, double *bytes)
+{
+    render_buf_t buf = { cells, RENDER_SECW, RENDER_HEIGHT };
+    render_rect_t dirty[RENDER_RECTS];
+    uint64_t spent = 0, sent = 0, t;
+    size_t len;
+    int i;
+
+    render_init(&render);
+    render.second = true;
+    render.utc = true;
+    render.sprites = true;
+    render_invalidate(&buf);
+    sixel_init(&sixel);
+
+    for(i = 0; i < BENCH_FRAMES; ++i) {
+        if(kind == COLD) {
+            sixel_init(&sixel);
+        } else if(kind == CACHED) {
+            sixel_invalidate(&sixel);
+        }
+        render_time(&render, (kind == TICK) ? TIME + i : TIME);
+        render_clock(&render, &buf, 0, 0, 0, dirty);
+
+        t = now_ns();
+        if(!sixel_frame(&sixel, &render, 0, 0, cellw, cellh, COLOR, false, &len)) {
+            len = 0;
+        }
+        spent += now_ns() - t;
+        sent += len;
+    }
+
+    *ns = (double)spent / BENCH_FRAMES;
+    *bytes = (double)sent / BENCH_FRAMES;
+
+    return;
+}
+
+
+int
+main(void)
+{
+    double ns, bytes;
+    size_t s;
+    int k;
+
+    printf("%-8s %8s %12s %12s\n", "cells", "frame", "encode us", "bytes");
+    for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        for(k = 0; k < KINDS; ++k) {
+            bench(k, sizes[s][0], sizes[s][1], &ns, &bytes);
+            printf("%3dx%-4d %8s %12.2f %12.0f\n", sizes[s][0], sizes[s][1],
+                   names[k], ns / 1e3, bytes);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,73 @@
+/*
+ *     TTY-CLOCK check.h file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#ifndef CHECK_H
+#define CHECK_H
+
+/*
+ * The little the tests share: CHECK() counts and reports a failed condition
+ * without stopping, check_done() is what main() returns. Needs stdbool and
+ * stdio.
+ */
+
+#define CHECK(cond) check_that((cond), #cond, __FILE__, __LINE__)
+
+static int check_run, check_failed;
+
+
+static void
+check_that(bool ok, const char *what, const char *file, int line)
+{
+    ++check_run;
+    if(!ok) {
+        ++check_failed;
+        fprintf(stderr, "%s:%d: FAILED: %s\n", file, line, what);
+    }
+
+    return;
+}
+
+
+static int
+check_done(const char *name)
+{
+    printf("%s: %d checks, %d failed\n", name, check_run, check_failed);
+
+    return (check_failed) ? 1 : 0;
+}
+
+#endif /* CHECK_H */
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,310 @@
+/*
+ *     TTY-CLOCK check_alloc.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Runs tty-clock on a pty with alloc.so preloaded, lets it tick, rebound,
+ * draw the analog face, the status panel, slide its digits, flash alarms and
+ * follow resizes, and fails if the redraw loop allocates once it warmed up,
+ * or if its resident size grows. A resize itself reallocates the screens of
+ * ncurses, so across resizes only the blocks alive have to stay the same.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "alloc.h"
+#include "check.h"
+
+#define CHECK_BIN    "bin/tty-clock"
+#define CHECK_LIB    "bin/alloc.so"
+#define CHECK_DELAY  "20000000" /* ns between frames, 50 a second */
+#define CHECK_WARM   1500       /* ms before the counting starts */
+#define CHECK_RUN    3000       /* ms counted */
+#define CHECK_SETTLE 200        /* ms for a resize to be drawn */
+#define CHECK_WARMUP 8          /* rounds of resizes before the counting */
+#define CHECK_CYCLES 3          /* rounds of resizes counted */
+#define CHECK_ALARMS "/tmp/tty-clock-alarms"
+
+/* A way of running tty-clock, with or without resizes */
+typedef struct {
+    const char *name;
+    const char *args[4];
+    bool resize;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "ticks",   { "-s", "-x", "-c", NULL },         false },
+    { "rebound", { "-s", "-r", NULL },               false },
+    { "analog",  { "-s", "-A", NULL },               false },
+    { "status",  { "-s", "-p", "1", NULL },          false },
+    { "slide",   { "-s", "-e", "slide", NULL },      false },
+    { "alarms",  { "-s", "-L", CHECK_ALARMS, NULL }, false },
+    { "resize",  { "-s", "-c", NULL },               true  },
+};
+
+/* Sizes the resize scenario goes through, rows and columns */
+static const unsigned short sizes[3][2] = { { 24, 80 }, { 30, 100 }, { 20, 60 } };
+
+static volatile alloc_count_t *count;
+
+
+/* Prototypes */
+static uint64_t now_ms(void);
+static bool pump(int fd, int ms);
+static long resident(pid_t pid);
+static void set_size(int fd, int i);
+static bool write_alarms(void);
+static void run(const scenario_t *s, const char *path);
+
+
+static uint64_t
+now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+
+/**
+ * Read and drop what the clock writes for ms, false once it closed the pty
+ */
+static bool
+pump(int fd, int ms)
+{
+    const uint64_t end = now_ms() + (uint64_t)ms;
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    char buf[4096];
+    uint64_t now;
+
+    while((now = now_ms()) < end) {
+        if(poll(&pfd, 1, (int)(end - now)) == 1 && read(fd, buf, sizeof(buf)) <= 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Resident pages of a process
+ */
+static long
+resident(pid_t pid)
+{
+    char path[64];
+    long size = 0, rss = -1;
+    FILE *file;
+
+    snprintf(path, sizeof(path), "/proc/%d/statm", (int)pid);
+    if((file = fopen(path, "r"))) {
+        if(fscanf(file, "%ld %ld", &size, &rss) != 2) {
+            rss = -1;
+        }
+        fclose(file);
+    }
+
+    return rss;
+}
+
+
+/**
+ * The pty sends SIGWINCH to the clock
+ */
+static void
+set_size(int fd, int i)
+{
+    const struct winsize ws = { sizes[i][0], sizes[i][1], 0, 0 };
+
+    ioctl(fd, TIOCSWINSZ, &ws);
+
+    return;
+}
+
+
+/**
+ * An alarm every second from the warm up to the end of the counted run,
+ * flashing and coloring in turn, daily so that firing queues them again
+ */
+static bool
+write_alarms(void)
+{
+    const time_t now = time(NULL);
+    struct tm tm;
+    time_t when;
+    FILE *file;
+
+    if(!(file = fopen(CHECK_ALARMS, "w"))) {
+        return false;
+    }
+    for(when = now + 1; when <= now + (CHECK_WARM + CHECK_RUN) / 1000 + 1; ++when) {
+        localtime_r(&when, &tm);
+        fprintf(file, "%02d:%02d:%02d 1 %s\n", tm.tm_hour, tm.tm_min, tm.tm_sec,
+                (when % 2) ? "flash" : "color 3");
+    }
+
+    return (fclose(file) == 0);
+}
+
+
+static void
+run(const scenario_t *s, const char *path)
+{
+    const struct winsize ws = { sizes[0][0], sizes[0][1], 0, 0 };
+    /* The common options, up to 3 of the scenario and NULL */
+    const char *argv[5 + 4] = { "tty-clock", "-d", "0", "-a", CHECK_DELAY };
+    alloc_count_t start, before;
+    int64_t calls = 0;
+    long rss;
+    int fd, i, c, status;
+    pid_t pid;
+
+    for(i = 0; s->args[i]; ++i) {
+        argv[5 + i] = s->args[i];
+        if(!strcmp(s->args[i], CHECK_ALARMS) && !write_alarms()) {
+            CHECK(!CHECK_ALARMS);
+            return;
+        }
+    }
+
+    if((pid = forkpty(&fd, NULL, NULL, &ws)) == -1) {
+        CHECK(!"forkpty");
+        return;
+    }
+    if(!pid) {
+        setenv("TERM", "xterm-256color", 1);
+        setenv(ALLOC_ENV, path, 1);
+        setenv("LD_PRELOAD", CHECK_LIB, 1);
+        /* Freed memory stays resident, so that RSS is the heap's peak */
+        setenv("GLIBC_TUNABLES", "glibc.malloc.trim_threshold=1073741824", 1);
+        execv(CHECK_BIN, (char *const *)argv);
+        _exit(127);
+    }
+
+    if(!s->resize) {
+        pump(fd, CHECK_WARM);
+        start = *count;
+        rss = resident(pid);
+        pump(fd, CHECK_RUN);
+        calls = count->calls - start.calls;
+    } else {
+        /*
+         * The heap takes a few rounds to settle on its largest size, after
+         * that a round must not add to it. The counted rounds end on the
+         * size the warm up ended on.
+         */
+        for(i = 0; i < CHECK_WARMUP * 3; ++i) {
+            set_size(fd, i % 3);
+            pump(fd, CHECK_SETTLE);
+        }
+        start = *count;
+        rss = resident(pid);
+        for(c = 0; c < CHECK_CYCLES; ++c) {
+            for(i = 0; i < 3; ++i) {
+                set_size(fd, i);
+                pump(fd, CHECK_SETTLE);
+                before = *count;
+                pump(fd, CHECK_RUN / 3);
+                calls += count->calls - before.calls;
+            }
+        }
+    }
+
+    printf("%-8s %6lld allocations, %+lld blocks alive, rss %ld -> %ld KB\n", s->name,
+           (long long)calls, (long long)(count->live - start.live),
+           rss * (sysconf(_SC_PAGESIZE) / 1024),
+           resident(pid) * (sysconf(_SC_PAGESIZE) / 1024));
+    CHECK(calls == 0);
+    CHECK(count->live == start.live);
+    CHECK(resident(pid) <= rss);
+
+    /* q, and read until it closed the pty so that it can't block on it */
+    CHECK(write(fd, "q", 1) == 1);
+    while(pump(fd, 1000));
+    close(fd);
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && !WEXITSTATUS(status));
+
+    return;
+}
+
+
+int
+main(void)
+{
+    char path[] = "/tmp/tty-clock-alloc.XXXXXX";
+    size_t i;
+    void *map;
+    int fd;
+
+    if((fd = mkstemp(path)) == -1 || ftruncate(fd, sizeof(alloc_count_t)) == -1) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    map = mmap(NULL, sizeof(alloc_count_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        perror(path);
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+    count = map;
+
+    for(i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i) {
+        memset(map, 0, sizeof(alloc_count_t));
+        run(&scenarios[i], path);
+    }
+
+    unlink(path);
+    unlink(CHECK_ALARMS);
+
+    return check_done("check-alloc");
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,283 @@
+/*
+ *     TTY-CLOCK check_sixel.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Decodes the output of sixel_frame() for a fixed time and checks that each
+ * image lands on its digit and shows the digit's glyph pixel for pixel, and
+ * that later frames only carry the digits which changed.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "anim.h"
+#include "render.h"
+#include "sixel.h"
+#include "check.h"
+
+#define CELLW     10
+#define CELLH     20
+#define IMAGE_W   (ANIM_COLS * 2 * CELLW)
+#define IMAGE_H   (ANIM_ROWS * CELLH)
+#define TIME      45296 /* 1970-01-01 12:34:56 UTC */
+#define COLOR     2
+
+/* An image as the terminal would draw it, at a 1-based row and column */
+typedef struct {
+    int row, col;
+    int w, h;
+    int rgb[3];
+    bool px[IMAGE_H][IMAGE_W];
+} image_t;
+
+static image_t images[ANIM_SLOTS];
+static int count;
+
+static render_t render;
+static render_cell_t cells[RENDER_HEIGHT * RENDER_SECW];
+static sixel_t sixel;
+
+
+/* Prototypes */
+static const char *number(const char *p, int *n);
+static const char *decode_image(const char *p, const char *end, image_t *img);
+static void decode(const char *buf, size_t len);
+static const char *frame_at(time_t lt, int color, size_t *len);
+static bool shows(const image_t *img, const uint8_t rows[ANIM_ROWS]);
+
+
+static const char *
+number(const char *p, int *n)
+{
+    *n = 0;
+    while(*p >= '0' && *p <= '9') {
+        *n = *n * 10 + (*p++ - '0');
+    }
+
+    return p;
+}
+
+
+/**
+ * The sixel data after ESC P, up to and with the ST
+ */
+static const char *
+decode_image(const char *p, const char *end, image_t *img)
+{
+    int x = 0, y = 0, n, k, reg[5], nreg;
+
+    while(p < end && *p++ != 'q');
+
+    while(p < end) {
+        if(*p == '\033') {
+            return p + 2;
+        } else if(*p == '"') {
+            p = number(p + 1, &n);
+            p = number(p + 1, &n);
+            p = number(p + 1, &img->w);
+            p = number(p + 1, &img->h);
+        } else if(*p == '#') {
+            for(nreg = 0; nreg < 5 && (nreg == 0 || *p == ';'); ++nreg) {
+                p = number(p + 1, &reg[nreg]);
+            }
+            if(nreg == 5) {
+                memcpy(img->rgb, reg + 2, sizeof(img->rgb));
+            }
+        } else if(*p == '-') {
+            x = 0;
+            y += 6;
+            ++p;
+        } else if(*p == '$') {
+            x = 0;
+            ++p;
+        } else {
+            n = 1;
+            if(*p == '!') {
+                p = number(p + 1, &n);
+            }
+            for(; n > 0; --n, ++x) {
+                for(k = 0; k < 6; ++k) {
+                    if(((*p - '?') >> k) & 1 && y + k < IMAGE_H && x < IMAGE_W) {
+                        img->px[y + k][x] = true;
+                    }
+                }
+            }
+            ++p;
+        }
+    }
+
+    return p;
+}
+
+
+/**
+ * Follow the cursor through a frame and decode the images it draws
+ */
+static void
+decode(const char *buf, size_t len)
+{
+    const char *p = buf, *end = buf + len;
+    int row = 1, col = 1, n, params[2];
+
+    memset(images, 0, sizeof(images));
+    count = 0;
+
+    while(p < end) {
+        if(*p++ != '\033' || p == end) {
+            continue;
+        }
+        if(*p == 'P') {
+            if(count == ANIM_SLOTS) {
+                CHECK(!"more images than digits");
+                return;
+            }
+            images[count].row = row;
+            images[count].col = col;
+            p = decode_image(p + 1, end, &images[count++]);
+        } else if(*p == '[') {
+            n = 0;
+            params[0] = params[1] = 1;
+            do {
+                p = number(p + 1, &params[n < 2 ? n : 1]);
+                ++n;
+            } while(p < end && *p == ';');
+            if(*p == 'H') {
+                row = params[0];
+                col = params[1];
+            }
+        }
+    }
+
+    return;
+}
+
+
+static const char *
+frame_at(time_t lt, int color, size_t *len)
+{
+    render_buf_t buf = { cells, RENDER_SECW, RENDER_HEIGHT };
+    render_rect_t dirty[RENDER_RECTS];
+
+    render_time(&render, lt);
+    render_clock(&render, &buf, 0, 0, 0, dirty);
+
+    return sixel_frame(&sixel, &render, 0, 0, CELLW, CELLH, color, false, len);
+}
+
+
+/**
+ * Every pixel set where the glyph has a bit, and none elsewhere
+ */
+static bool
+shows(const image_t *img, const uint8_t rows[ANIM_ROWS])
+{
+    int x, y;
+
+    for(y = 0; y < IMAGE_H; ++y) {
+        for(x = 0; x < IMAGE_W; ++x) {
+            if(img->px[y][x] != (bool)((rows[y / CELLH] >> (2 - x / (2 * CELLW))) & 1)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+int
+main(void)
+{
+    render_buf_t buf = { cells, RENDER_SECW, RENDER_HEIGHT };
+    const char *out;
+    size_t len;
+    int i;
+
+    render_init(&render);
+    render.second = true;
+    render.utc = true;
+    render.sprites = true;
+    render_invalidate(&buf);
+    sixel_init(&sixel);
+
+    /* The first frame draws every digit of 12:34:56 */
+    out = frame_at(TIME, COLOR, &len);
+    CHECK(out != NULL);
+    decode(out, len);
+    CHECK(count == ANIM_SLOTS);
+    for(i = 0; i < count; ++i) {
+        CHECK(images[i].row == 2);
+        CHECK(images[i].col == render_digit_x(i) + 1);
+        CHECK(images[i].w == IMAGE_W && images[i].h == IMAGE_H);
+        CHECK(images[i].rgb[0] == 0 && images[i].rgb[1] == 80 && images[i].rgb[2] == 0);
+        CHECK(shows(&images[i], render.rows[i]));
+    }
+    CHECK(render.date.hour[0] == 1 && render.date.second[1] == 6);
+
+    /* Nothing changed, nothing is sent */
+    CHECK(frame_at(TIME, COLOR, &len) == NULL);
+
+    /* A second later only the last digit is drawn again */
+    out = frame_at(TIME + 1, COLOR, &len);
+    CHECK(out != NULL);
+    decode(out, len);
+    CHECK(count == 1);
+    CHECK(images[0].col == render_digit_x(5) + 1);
+    CHECK(shows(&images[0], render.rows[5]));
+
+    /* Hidden by an alarm: the cells are cleared, no image is drawn */
+    out = frame_at(TIME + 1, -1, &len);
+    CHECK(out != NULL);
+    decode(out, len);
+    CHECK(count == 0);
+
+    /* After an invalidate every digit comes again, from the cache */
+    frame_at(TIME + 1, COLOR, &len);
+    sixel_invalidate(&sixel);
+    out = frame_at(TIME + 1, COLOR, &len);
+    CHECK(out != NULL);
+    decode(out, len);
+    CHECK(count == ANIM_SLOTS);
+    for(i = 0; i < count; ++i) {
+        CHECK(shows(&images[i], render.rows[i]));
+    }
+
+    return check_done("check-sixel");
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,328 @@
+/*
+ *     TTY-CLOCK check_wallclock.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Steps a fake wall clock forward and back under the wall clock watch and
+ * checks the size of each jump it reports. The timer itself is the
+ * kernel's, only the clocks the jumps are measured with are faked.
+ *
+ * Then runs tty-clock on a pty with fakeclock.so preloaded, steps its clock
+ * forward and back, and checks that each step is logged once and at once
+ * redraws the whole screen with the new time, long before the next tick.
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "wallclock.h"
+#include "fakeclock.h"
+#include "check.h"
+
+#define SECOND 1000000000LL
+
+#define CHECK_BIN    "bin/tty-clock"
+#define CHECK_LIB    "bin/fakeclock.so"
+#define CHECK_FIFO   "/tmp/tty-clock-step"
+#define CHECK_LOG    "/tmp/tty-clock-steps"
+#define CHECK_FORMAT "%H:%M:%S" /* the date line shows the time as text */
+#define CHECK_WARM   1000       /* ms for the first frame */
+#define CHECK_SETTLE 500        /* ms for a step to be drawn, the delay is 30s */
+#define CHECK_OUT    65536
+
+/* CLOCK_REALTIME - CLOCK_MONOTONIC as the fake clock has it */
+static int64_t fake;
+
+/* The clock of tty-clock, shared with fakeclock.so */
+static volatile fakeclock_t *faked;
+
+
+/* Prototypes */
+static int64_t fake_offset(void);
+static void offsets(void);
+static uint64_t now_ms(void);
+static size_t capture(int fd, int ms, char *out, size_t size);
+static unsigned int count(const char *out, size_t len, const char *what);
+static void step(int fd, int fifo, int64_t jump);
+static void run(const char *path);
+
+
+static int64_t
+fake_offset(void)
+{
+    return fake;
+}
+
+
+/**
+ * The jumps wallclock_rearm() measures, against a clock of our own
+ */
+static void
+offsets(void)
+{
+    int64_t jump = 0;
+    int fd;
+
+    fake = 1700000000 * SECOND;
+    wallclock_source(fake_offset);
+
+    /* Elsewhere there is no timer, the jumps are measured all the same */
+    fd = wallclock_watch();
+#ifdef __linux__
+    CHECK(fd >= 0);
+#endif
+
+    /* Nothing moved */
+    CHECK(wallclock_rearm(fd) == 0);
+
+    /* An hour forward, as a DST mistake set right by hand */
+    fake += 3600 * SECOND;
+    CHECK(wallclock_rearm(fd) == 3600 * SECOND);
+
+    /* Two hours back, then it stays */
+    fake -= 7200 * SECOND;
+    CHECK(wallclock_rearm(fd) == -7200 * SECOND);
+    CHECK(wallclock_rearm(fd) == 0);
+
+    /* A step smaller than a tick is still seen, to the ns */
+    fake += SECOND / 3;
+    CHECK(wallclock_rearm(fd) == SECOND / 3);
+    fake -= 1;
+    CHECK(wallclock_rearm(fd) == -1);
+
+    /* The timer doesn't fire without a real step */
+    CHECK(fd < 0 || !wallclock_changed(fd, &jump));
+    CHECK(jump == 0);
+    if(fd >= 0) {
+        close(fd);
+    }
+
+    wallclock_source(NULL);
+
+    return;
+}
+
+
+static uint64_t
+now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+
+/**
+ * Read what the clock writes for ms into out, as much as fits. Returns the
+ * length kept, 0 once it closed the pty.
+ */
+static size_t
+capture(int fd, int ms, char *out, size_t size)
+{
+    const uint64_t end = now_ms() + (uint64_t)ms;
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    char buf[4096];
+    size_t len = 0, n;
+    uint64_t now;
+    ssize_t got;
+
+    while((now = now_ms()) < end) {
+        if(poll(&pfd, 1, (int)(end - now)) != 1) {
+            continue;
+        }
+        if((got = read(fd, buf, sizeof(buf))) <= 0) {
+            return 0;
+        }
+        n = ((size_t)got < size - len) ? (size_t)got : size - len;
+        memcpy(out + len, buf, n);
+        len += n;
+    }
+
+    return len;
+}
+
+
+static unsigned int
+count(const char *out, size_t len, const char *what)
+{
+    const size_t n = strlen(what);
+    unsigned int found = 0;
+    const char *at;
+
+    while((at = memmem(out, len, what, n))) {
+        ++found;
+        len -= (size_t)(at + n - out);
+        out = at + n;
+    }
+
+    return found;
+}
+
+
+/**
+ * Move the clock by jump ns and tell its timer, as settimeofday() would
+ */
+static void
+step(int fd, int fifo, int64_t jump)
+{
+    static char out[CHECK_OUT];
+    char shown[2][16];
+    struct tm tm;
+    size_t len;
+    time_t now, when;
+    int i;
+
+    faked->offset += jump;
+    CHECK(write(fifo, "s", 1) == 1);
+    len = capture(fd, CHECK_SETTLE, out, sizeof(out));
+
+    /* One frame, with the screen cleared first, and the time it was drawn at */
+    CHECK(count(out, len, "\033[2J") == 1);
+    now = time(NULL) + (time_t)(faked->offset / SECOND);
+    for(i = 0; i < 2; ++i) {
+        when = now - i;
+        localtime_r(&when, &tm);
+        strftime(shown[i], sizeof(shown[i]), CHECK_FORMAT, &tm);
+    }
+    CHECK(count(out, len, shown[0]) + count(out, len, shown[1]) == 1);
+
+    return;
+}
+
+
+static void
+run(const char *path)
+{
+    const struct winsize ws = { 24, 80, 0, 0 };
+    const char *argv[] = { "tty-clock", "-d", "30", "-f", CHECK_FORMAT, NULL };
+    static char out[CHECK_OUT];
+    char line[128];
+    unsigned int lines = 0;
+    int fd, fifo, status;
+    FILE *log;
+    pid_t pid;
+
+    unlink(CHECK_FIFO);
+    /* Open for reading too, so that writing to it doesn't wait for the clock */
+    if(mkfifo(CHECK_FIFO, 0600) == -1 || (fifo = open(CHECK_FIFO, O_RDWR)) == -1) {
+        CHECK(!CHECK_FIFO);
+        return;
+    }
+    if((pid = forkpty(&fd, NULL, NULL, &ws)) == -1) {
+        CHECK(!"forkpty");
+        close(fifo);
+        return;
+    }
+    if(!pid) {
+        /* Not a tty, so that the steps are logged as they come */
+        if(!freopen(CHECK_LOG, "w", stderr)) {
+            _exit(127);
+        }
+        setenv("TERM", "xterm-256color", 1);
+        setenv(FAKECLOCK_ENV, path, 1);
+        setenv(FAKECLOCK_FIFO_ENV, CHECK_FIFO, 1);
+        setenv("LD_PRELOAD", CHECK_LIB, 1);
+        execv(CHECK_BIN, (char *const *)argv);
+        _exit(127);
+    }
+
+    capture(fd, CHECK_WARM, out, sizeof(out));
+    /* An hour forward, then two back */
+    step(fd, fifo, 3600 * SECOND);
+    step(fd, fifo, -7200 * SECOND);
+
+    /* q, and read until it closed the pty so that it can't block on it */
+    CHECK(write(fd, "q", 1) == 1);
+    while(capture(fd, 1000, out, sizeof(out)));
+    close(fd);
+    close(fifo);
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && !WEXITSTATUS(status));
+
+    /* Each step once, none left over for the report on exit */
+    if((log = fopen(CHECK_LOG, "r"))) {
+        while(fgets(line, sizeof(line), log)) {
+            printf("%s", line);
+            CHECK(strstr(line, (lines++) ? "stepped by -7200.000s" : "stepped by +3600.000s"));
+        }
+        fclose(log);
+    }
+    CHECK(lines == 2);
+
+    unlink(CHECK_FIFO);
+    unlink(CHECK_LOG);
+
+    return;
+}
+
+
+int
+main(void)
+{
+    char path[] = "/tmp/tty-clock-clock.XXXXXX";
+    void *map;
+    int fd;
+
+    offsets();
+
+    if((fd = mkstemp(path)) == -1 || ftruncate(fd, sizeof(fakeclock_t)) == -1) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    map = mmap(NULL, sizeof(fakeclock_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        perror(path);
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+    faked = map;
+    run(path);
+    unlink(path);
+
+    return check_done("check-wallclock");
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4
@@ -0,0 +1,205 @@
+/*
+ *     TTY-CLOCK fakeclock.c file.
+ *     Copyright (c) 2023 Stephan Laukien <software@laukien.com>
+ *     Copyright (c) 2009-2018 tty-clock contributors
+ *     Copyright (c) 2008-2009 Martin Duquesnoy <xorg62@gmail.com>
+ *     All rights reserved.
+ *
+ *     Redistribution and use in source and binary forms, with or without
+ *     modification, are permitted provided that the following conditions are
+ *     met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following disclaimer
+ *       in the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of the  nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *     "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *     A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *     OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *     LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *     DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *     THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *     (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *     OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Preloaded into tty-clock by check-wallclock: moves CLOCK_REALTIME, time()
+ * and gettimeofday() by the offset in a shared file, and stands in for the
+ * CLOCK_REALTIME timerfd with a FIFO, which reads as cancelled (ECANCELED)
+ * once check-wallclock wrote to it. The monotonic clock is left alone.
+ */
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "fakeclock.h"
+
+/* NULL until the file is mapped, the clock is the real one before */
+static fakeclock_t *fake;
+
+/* The FIFO given for the timerfd, -1 if none */
+static int timer = -1;
+
+/* The functions of libc, found in setup() */
+static int (*real_clock_gettime)(clockid_t id, struct timespec *ts);
+static ssize_t (*real_read)(int fd, void *buf, size_t len);
+static int (*real_timerfd_create)(int id, int flags);
+static int (*real_timerfd_settime)(int fd, int flags, const struct itimerspec *its,
+                                   struct itimerspec *old);
+
+
+/* Prototypes */
+static void setup(void) __attribute__((constructor));
+static void shift(struct timespec *ts);
+
+
+static void
+setup(void)
+{
+    const char *path = getenv(FAKECLOCK_ENV);
+    void *map;
+    int fd;
+
+    real_clock_gettime = (int (*)(clockid_t, struct timespec *))dlsym(RTLD_NEXT, "clock_gettime");
+    real_read = (ssize_t (*)(int, void *, size_t))dlsym(RTLD_NEXT, "read");
+    real_timerfd_create = (int (*)(int, int))dlsym(RTLD_NEXT, "timerfd_create");
+    real_timerfd_settime = (int (*)(int, int, const struct itimerspec *, struct itimerspec *))
+                           dlsym(RTLD_NEXT, "timerfd_settime");
+
+    if(!path || (fd = open(path, O_RDWR)) == -1) {
+        return;
+    }
+    map = mmap(NULL, sizeof(fakeclock_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map != MAP_FAILED) {
+        fake = map;
+    }
+
+    return;
+}
+
+
+static void
+shift(struct timespec *ts)
+{
+    int64_t ns;
+
+    if(!fake) {
+        return;
+    }
+    ns = (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec
+         + __atomic_load_n(&fake->offset, __ATOMIC_RELAXED);
+    ts->tv_sec = (time_t)(ns / 1000000000);
+    ts->tv_nsec = (long)(ns % 1000000000);
+
+    return;
+}
+
+
+int
+clock_gettime(clockid_t id, struct timespec *ts)
+{
+    const int ret = real_clock_gettime(id, ts);
+
+    if(!ret && (id == CLOCK_REALTIME || id == CLOCK_REALTIME_COARSE)) {
+        shift(ts);
+    }
+
+    return ret;
+}
+
+
+time_t
+time(time_t *t)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if(t) {
+        *t = ts.tv_sec;
+    }
+
+    return ts.tv_sec;
+}
+
+
+int
+gettimeofday(struct timeval *tv, void *tz)
+{
+    struct timespec ts;
+
+    (void)tz;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    tv->tv_sec = ts.tv_sec;
+    tv->tv_usec = (suseconds_t)(ts.tv_nsec / 1000);
+
+    return 0;
+}
+
+
+int
+timerfd_create(int id, int flags)
+{
+    const char *path = getenv(FAKECLOCK_FIFO_ENV);
+
+    if(id != CLOCK_REALTIME || !path) {
+        return real_timerfd_create(id, flags);
+    }
+    /* Opened for writing too, so that it never reads as closed */
+    timer = open(path, O_RDWR | O_NONBLOCK | ((flags & TFD_CLOEXEC) ? O_CLOEXEC : 0));
+
+    return timer;
+}
+
+
+int
+timerfd_settime(int fd, int flags, const struct itimerspec *its, struct itimerspec *old)
+{
+    if(fd != timer || timer == -1) {
+        return real_timerfd_settime(fd, flags, its, old);
+    }
+
+    return 0;
+}
+
+
+ssize_t
+read(int fd, void *buf, size_t len)
+{
+    char steps[64];
+    ssize_t n;
+
+    if(fd != timer || timer == -1) {
+        return real_read(fd, buf, len);
+    }
+
+    /* Any number of steps since the last read is one cancel, as in the kernel */
+    if((n = real_read(fd, steps, sizeof(steps))) > 0) {
+        while(real_read(fd, steps, sizeof(steps)) > 0);
+        errno = ECANCELED;
+    } else if(!n) {
+        errno = EAGAIN;
+    }
+
+    return -1;
+}
+
+// vim: expandtab tabstop=4 softtabstop=4 shiftwidth=4